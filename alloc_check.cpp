@@ -0,0 +1,137 @@
+// Zero-allocation check for the steady-state tick
+//
+//   g++ -std=c++17 -O2 -g -rdynamic -pthread alloc_check.cpp -o alloc_check
+//   ./alloc_check [--warmup N] [--ticks N]
+//
+// Plays the game's own frame (see game.h) off-screen: input through the
+// turn queue, the fixed-timestep clock, game_tick, recording, the journal
+// and its checkpoints, a ghost, the echo, the HUD, trace spans and refresh
+// into a discarding stream. The clock is fed one frame interval per frame,
+// so every frame runs one step. After the warm-up, any heap allocation, on
+// any thread, fails the check and prints the stack of the first one. The
+// snake circles without eating: growth may allocate (the body ring
+// doubles), a tick that only moves must not.
+
+#include "alloc_counter.h"
+#include "curses.h"
+#include "game.h"
+#include "trace.h"
+#include <chrono>
+#include <string>
+
+TerminalUI ui;
+
+// A loop in the top rows, clear of where food can appear
+static const int KEYS[] = {'d', 's', 'a', 'w'};
+static const int LEGS[] = {20, 4, 20, 4};
+
+int main(int argc, char** argv) {
+    long warmup = 1000;
+    long ticks = 100000;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) warmup = atol(argv[++i]);
+        else if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) ticks = atol(argv[++i]);
+        else {
+            fprintf(stderr, "usage: alloc_check [--warmup N] [--ticks N]\n");
+            return 2;
+        }
+    }
+    alloc_counter::prepare();
+
+    const int HEIGHT = 24, WIDTH = 80;
+    const int FOOD_MIN = 10, FOOD_MAX = HEIGHT - 10;
+    const unsigned SEED = 42;
+    const uint32_t ECHO_DELAY = 10;     // well short of a lap, so it never catches the snake
+    WINDOW* window = ui.newwin(HEIGHT, WIDTH, 0, 0);
+    ui.use_window(window);
+    sysio::NullBuffer null_buffer;
+    std::ostream null_sink(&null_buffer);
+    std::ostream& terminal = ui.set_output(null_sink);
+    trace::start();
+
+    Game game(2, 8, FOOD_MIN, FOOD_MAX, SEED);
+    FrameHud hud;
+    hud.toggle();
+
+    // The ghost laps the same loop two rows lower
+    std::vector<uint8_t> ghost_moves;
+    for (long tick = 0; tick < warmup + ticks; tick += LEGS[0] + LEGS[1] + LEGS[2] + LEGS[3]) {
+        const int directions[] = {KEY_RIGHT, KEY_DOWN, KEY_LEFT, KEY_UP};
+        for (int leg = 0; leg < 4; ++leg) ghost_moves.insert(ghost_moves.end(), LEGS[leg], encode_direction(directions[leg]));
+    }
+    game.ghosts.add(make_replay_header(SEED, HEIGHT, WIDTH, 4, 8, FOOD_MIN, FOOD_MAX), std::move(ghost_moves));
+
+    game.echo_on = true;
+    game.echo.start(game.snake, HEIGHT, WIDTH, ECHO_DELAY);
+
+    // Recording and journal go to scratch files; the journal to shared
+    // memory where there is one, so its syncs keep up with the loop
+    ReplayHeader header = make_replay_header(SEED, HEIGHT, WIDTH, game.snake.get_y(), game.snake.get_x(),
+                                             FOOD_MIN, FOOD_MAX);
+    std::string scratch = (access("/dev/shm", W_OK) == 0 ? "/dev/shm" : "/tmp");
+    scratch += "/alloc_check-" + std::to_string(getpid());
+    std::string record_path = scratch + ".replay", journal_path = scratch + ".journal";
+    if (!game.recorder.open(record_path.c_str(), header) || !game.journal.create(journal_path.c_str(), header)) {
+        fprintf(stderr, "alloc_check: cannot write scratch files under %s\n", scratch.c_str());
+        return 1;
+    }
+
+    const auto INTERVAL = std::chrono::milliseconds(100);
+    FrameClock frame_clock(INTERVAL, INTERVAL, 1.0, 1000);
+    auto now = FrameClock::Clock::now();
+    frame_clock.restart(now);
+    int leg = 0, leg_ticks = 0;
+    int status = 0;
+
+    for (long tick = 0; tick < warmup + ticks; ++tick) {
+        if (tick == warmup) alloc_counter::arm();
+        unsigned long before = alloc_counter::count();
+
+        auto start = std::chrono::steady_clock::now();
+        if (++leg_ticks > LEGS[leg]) {
+            leg = (leg + 1) % 4;
+            leg_ticks = 1;
+            game.key(KEYS[leg]);
+        }
+        now += INTERVAL;
+        {
+            TRACE_SCOPE("tick");
+            game.tick(frame_clock.advance(now));
+        }
+        auto ticked = std::chrono::steady_clock::now();
+        game.draw_overlays(hud, window);
+        {
+            TRACE_SCOPE("refresh");
+            ui.refresh();
+        }
+        auto rendered = std::chrono::steady_clock::now();
+        game.erase_overlays(hud);
+        hud.record_tick(std::chrono::duration_cast<std::chrono::nanoseconds>(ticked - start).count());
+        hud.record_render(std::chrono::duration_cast<std::chrono::nanoseconds>(rendered - ticked).count());
+        hud.record_bytes(ui.refresh_bytes());
+
+        if (game.caught) {
+            fprintf(stderr, "alloc_check: the echo caught the snake at tick %ld\n", tick);
+            status = 1;
+            break;
+        }
+        if (tick >= warmup && alloc_counter::count() != before) {
+            alloc_counter::disarm();
+            fprintf(stderr, "alloc_check: tick %ld (%ld after warm-up) made %lu allocation(s)\n",
+                    tick, tick - warmup, alloc_counter::count() - before);
+            alloc_counter::print_first(stderr);
+            status = 1;
+            break;
+        }
+    }
+    alloc_counter::disarm();
+
+    game.recorder.close();
+    game.journal.close();
+    unlink(record_path.c_str());
+    unlink(journal_path.c_str());
+    ui.set_output(terminal);
+    ui.delwin(window);
+    if (status == 0) printf("alloc_check: %ld ticks after %ld warm-up ticks, no allocations\n", ticks, warmup);
+    return status;
+}
@@ -0,0 +1,105 @@
+#ifndef SNAKE_ALLOC_COUNTER_H
+#define SNAKE_ALLOC_COUNTER_H
+
+// Counting replacement for the global operator new/delete
+//
+// Include from exactly one translation unit of a program: it defines the
+// replaceable allocation functions. Every allocation is counted; while the
+// counter is armed, the stack of the first allocation is captured so a test
+// can say not just that something allocated but where.
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if defined(__linux__) || defined(__APPLE__)
+    #include <execinfo.h>
+    #include <unistd.h>
+    #define SNAKE_ALLOC_BACKTRACE 1
+#endif
+
+namespace alloc_counter {
+
+static const int MAX_FRAMES = 32;
+
+inline std::atomic<unsigned long> allocations{0};
+inline std::atomic<unsigned long> frees{0};
+inline std::atomic<bool> armed{false};
+inline std::atomic<bool> captured{false};
+inline void* first_stack[MAX_FRAMES];
+inline int first_depth = 0;
+inline size_t first_size = 0;
+
+// backtrace() allocates the first time it runs, so do that while disarmed
+inline void prepare() {
+    #ifdef SNAKE_ALLOC_BACKTRACE
+    void* frames[4];
+    backtrace(frames, 4);
+    #endif
+}
+
+inline void arm() {
+    captured = false;
+    first_depth = 0;
+    armed = true;
+}
+
+inline void disarm() { armed = false; }
+
+inline unsigned long count() { return allocations.load(std::memory_order_relaxed); }
+
+inline void on_allocate(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (armed.load(std::memory_order_relaxed) && !captured.exchange(true)) {
+        first_size = size;
+        #ifdef SNAKE_ALLOC_BACKTRACE
+        first_depth = backtrace(first_stack, MAX_FRAMES);
+        #endif
+    }
+}
+
+inline void print_first(FILE* out) {
+    if (!captured) return;
+    fprintf(out, "first allocation (%zu bytes) at:\n", first_size);
+    fflush(out);
+    #ifdef SNAKE_ALLOC_BACKTRACE
+    backtrace_symbols_fd(first_stack, first_depth, fileno(out));
+    #else
+    fprintf(out, "  (no backtrace support on this platform)\n");
+    #endif
+}
+
+inline void* allocate(size_t size) {
+    on_allocate(size);
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+inline void release(void* p) {
+    if (!p) return;
+    frees.fetch_add(1, std::memory_order_relaxed);
+    std::free(p);
+}
+
+} // namespace alloc_counter
+
+void* operator new(size_t size) { return alloc_counter::allocate(size); }
+void* operator new[](size_t size) { return alloc_counter::allocate(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    alloc_counter::on_allocate(size);
+    return std::malloc(size ? size : 1);
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    alloc_counter::on_allocate(size);
+    return std::malloc(size ? size : 1);
+}
+void operator delete(void* p) noexcept { alloc_counter::release(p); }
+void operator delete[](void* p) noexcept { alloc_counter::release(p); }
+void operator delete(void* p, size_t) noexcept { alloc_counter::release(p); }
+void operator delete[](void* p, size_t) noexcept { alloc_counter::release(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { alloc_counter::release(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { alloc_counter::release(p); }
+
+#endif // SNAKE_ALLOC_COUNTER_H
@@ -0,0 +1,461 @@
+// Benchmarks for the game's hot paths
+//
+//   g++ -std=c++17 -O2 bench.cpp -o bench
+//   ./bench [--filter SUBSTR] [--reps N] [--min-time-ms MS] [--json FILE] [--perf]
+//   ./bench --compare bench_baseline.json [--threshold PCT] [--alpha A] [--confirm N]
+//
+// Everything is seeded with fixed values so runs are comparable between
+// commits. The table goes to stderr, JSON to stdout or --json FILE.
+// With --compare the run is checked against a baseline written by --json
+// and the exit status is 1 if any benchmark regressed; see bench_compare.h
+// for how noise is told apart. Refresh the checked-in baseline with
+// `./bench --json bench_baseline.json` on the gating machine.
+
+#include "curses.h"
+#include "snake.h"
+#include "bench.h"
+#include "bench_compare.h"
+#include "journal.h"
+#include <fcntl.h>
+#include <stdlib.h>
+
+TerminalUI ui;
+
+static const unsigned SEED = 42;
+
+// Selects a fresh off-screen window for the duration of a benchmark
+class ScopedWindow {
+    private:
+        WINDOW* window;
+        WINDOW* previous;
+    public:
+        ScopedWindow(int height, int width):
+            window{ui.newwin(height, width, 0, 0)}, previous{ui.use_window(window)} {}
+        ~ScopedWindow() {
+            ui.use_window(previous);
+            ui.delwin(window);
+        }
+        WINDOW* get() { return window; }
+};
+
+// A closed loop of board positions two columns apart, like a moving snake's
+static std::vector<std::array<int, 2>> loop_path(int size) {
+    std::vector<std::array<int, 2>> path;
+    for (int i = 0; i < size; ++i) path.push_back({1, 2 + 2 * i});
+    for (int i = 0; i < size; ++i) path.push_back({2, 2 + 2 * (size - 1 - i)});
+    return path;
+}
+
+// Tail benchmarks run once per body storage policy; the plain names are
+// the default BodyRing. A tail made at (1, 8) lies on the first three cells
+// of loop_path(), so it moves on from the fourth.
+static const size_t TAIL_PATH_START = 3;
+
+template <typename Storage>
+static void tail_move_with(BenchState& state) {
+    ScopedWindow window(24, 160);
+    auto path = loop_path(64);
+    BasicTail<Storage> tail('#', 1, 8);
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        const auto& next = path[(TAIL_PATH_START + i) % path.size()];
+        tail.move(next[0], next[1]);
+    }
+    state.stop();
+}
+
+static void tail_move(BenchState& state) { tail_move_with<BodyRing>(state); }
+BENCHMARK(tail_move);
+
+static void tail_move_deque(BenchState& state) { tail_move_with<DequeBody>(state); }
+BENCHMARK(tail_move_deque);
+
+static void tail_move_soa(BenchState& state) { tail_move_with<SoABody>(state); }
+BENCHMARK(tail_move_soa);
+
+static void tail_move_chain(BenchState& state) { tail_move_with<ChainBody>(state); }
+BENCHMARK(tail_move_chain);
+
+template <typename Storage>
+static void tail_add_with(BenchState& state) {
+    ScopedWindow window(24, 160);
+    auto path = loop_path(64);
+    const uint64_t RESET_EVERY = 4096;
+    uint64_t done = 0;
+    while (done < state.iterations) {
+        BasicTail<Storage> tail('#', 1, 8);
+        uint64_t batch = std::min(RESET_EVERY, state.iterations - done);
+        state.start();
+        for (uint64_t i = 0; i < batch; ++i) {
+            const auto& next = path[(TAIL_PATH_START + i) % path.size()];
+            tail.add(next[0], next[1]);
+        }
+        state.stop();
+        done += batch;
+    }
+}
+
+static void tail_add(BenchState& state) { tail_add_with<BodyRing>(state); }
+BENCHMARK(tail_add);
+
+static void tail_add_deque(BenchState& state) { tail_add_with<DequeBody>(state); }
+BENCHMARK(tail_add_deque);
+
+static void tail_add_soa(BenchState& state) { tail_add_with<SoABody>(state); }
+BENCHMARK(tail_add_soa);
+
+static void tail_add_chain(BenchState& state) { tail_add_with<ChainBody>(state); }
+BENCHMARK(tail_add_chain);
+
+// Reading a 10,000-segment body front to back, as drawing ghosts or taking
+// a checkpoint does; one op is one segment
+template <typename Storage>
+static void body_scan_with(BenchState& state) {
+    const size_t SEGMENTS = 10000;
+    Storage body;
+    for (const auto& cell : loop_path(SEGMENTS / 2)) body.push_back(cell);
+    int64_t sum = 0;
+    uint64_t done = 0;
+    state.start();
+    while (done < state.iterations) {
+        size_t batch = std::min<uint64_t>(SEGMENTS, state.iterations - done);
+        for (size_t i = 0; i < batch; ++i) {
+            const auto& cell = body.at(i);
+            sum += cell[0] * 131 + cell[1];
+        }
+        done += batch;
+    }
+    state.stop();
+    do_not_optimize(sum);
+}
+
+static void body_scan(BenchState& state) { body_scan_with<BodyRing>(state); }
+BENCHMARK(body_scan);
+
+static void body_scan_deque(BenchState& state) { body_scan_with<DequeBody>(state); }
+BENCHMARK(body_scan_deque);
+
+static void body_scan_soa(BenchState& state) { body_scan_with<SoABody>(state); }
+BENCHMARK(body_scan_soa);
+
+static void body_scan_chain(BenchState& state) { body_scan_with<ChainBody>(state); }
+BENCHMARK(body_scan_chain);
+
+// Encoding a 10,000-segment body as a chain, as a checkpoint does; one op
+// is one segment
+static void body_chain_encode(BenchState& state) {
+    const size_t SEGMENTS = 10000;
+    BodyRing body;
+    for (const auto& cell : loop_path(SEGMENTS / 2)) body.push_back(cell);
+    BodyChain chain;
+    uint64_t done = 0;
+    state.start();
+    while (done < state.iterations) {
+        to_chain(body, chain);
+        do_not_optimize(chain);
+        done += SEGMENTS;
+    }
+    state.stop();
+    state.counter("chain_bytes", (double)chain.links.size() * sizeof(uint64_t));
+}
+BENCHMARK(body_chain_encode);
+
+static void snake_move(BenchState& state) {
+    ScopedWindow window(24, 80);
+    Snake snake(10, 10, '@');
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; i += 4) {
+        snake.move_right();
+        snake.move_down();
+        snake.move_left();
+        snake.move_up();
+    }
+    state.stop();
+}
+BENCHMARK(snake_move);
+
+// snake_move on a torus, from the corner so that every step crosses an edge
+static void snake_move_wrap(BenchState& state) {
+    ScopedWindow window(24, 80);
+    Snake snake(78, 23, '@');
+    snake.set_topology(Topology::torus(24, 80));
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; i += 4) {
+        snake.move_right();
+        snake.move_down();
+        snake.move_left();
+        snake.move_up();
+    }
+    state.stop();
+}
+BENCHMARK(snake_move_wrap);
+
+static void snake_add(BenchState& state) {
+    ScopedWindow window(24, 80);
+    const uint64_t RESET_EVERY = 4096;
+    uint64_t done = 0;
+    while (done < state.iterations) {
+        Snake snake(10, 10, '@');
+        uint64_t batch = std::min(RESET_EVERY, state.iterations - done);
+        state.start();
+        for (uint64_t i = 0; i < batch; i += 4) {
+            snake.add_right();
+            snake.add_down();
+            snake.add_left();
+            snake.add_up();
+        }
+        state.stop();
+        done += batch;
+    }
+}
+BENCHMARK(snake_add);
+
+static void food_place(BenchState& state) {
+    ScopedWindow window(24, 80);
+    Food apple('O', 10, 14, SEED);
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        apple.place(10, 14);
+    }
+    state.stop();
+    do_not_optimize(apple.get_x());
+}
+BENCHMARK(food_place);
+
+static void ui_mvaddch(BenchState& state) {
+    ScopedWindow window(24, 80);
+    uint32_t lcg = SEED;
+    std::vector<std::array<int, 2>> cells(1024);
+    for (auto& cell : cells) {
+        lcg = lcg * 1664525u + 1013904223u;
+        cell = {(int)((lcg >> 8) % 24), (int)((lcg >> 16) % 80)};
+    }
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        const auto& cell = cells[i & 1023];
+        ui.mvaddch(cell[0], cell[1], (char)('a' + (i & 15)));
+    }
+    state.stop();
+}
+BENCHMARK(ui_mvaddch);
+
+static void refresh_null(BenchState& state, int height, int width) {
+    ScopedWindow window(height, width);
+    sysio::NullBuffer null_buffer;
+    std::ostream null_sink(&null_buffer);
+    std::ostream& terminal = ui.set_output(null_sink);
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        ui.refresh();
+    }
+    state.stop();
+    ui.set_output(terminal);
+}
+
+static void ui_refresh_null_80x24(BenchState& state) { refresh_null(state, 24, 80); }
+BENCHMARK(ui_refresh_null_80x24);
+
+static void ui_refresh_null_200x60(BenchState& state) { refresh_null(state, 60, 200); }
+BENCHMARK(ui_refresh_null_200x60);
+
+// Swaps stdin for an idle pseudo-terminal for the lifetime of the object
+class IdleTerminal {
+    private:
+        int master;
+        int slave;
+        int saved_stdin;
+        std::string failure;
+    public:
+        IdleTerminal(): master(posix_openpt(O_RDWR | O_NOCTTY)), slave(-1), saved_stdin(-1) {
+            if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+                failure = std::string("cannot open a pseudo-terminal: ") + strerror(errno);
+                return;
+            }
+            slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+            if (slave < 0) {
+                failure = std::string("cannot open ") + ptsname(master) + ": " + strerror(errno);
+                return;
+            }
+            saved_stdin = dup(STDIN_FILENO);
+            dup2(slave, STDIN_FILENO);
+        }
+        ~IdleTerminal() {
+            if (saved_stdin >= 0) {
+                dup2(saved_stdin, STDIN_FILENO);
+                close(saved_stdin);
+            }
+            if (slave >= 0) close(slave);
+            if (master >= 0) close(master);
+        }
+        bool ok() const { return saved_stdin >= 0; }
+        const std::string& error() const { return failure; }
+};
+
+static void getch_poll(BenchState& state) {
+    IdleTerminal terminal;
+    if (!terminal.ok()) {
+        state.skip(terminal.error());
+        return;
+    }
+
+    int seen = 0;
+    sysio::Snapshot before = sysio::snapshot();
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        seen += ui.getch() != ERR;
+    }
+    state.stop();
+    do_not_optimize(seen);
+    state.counter("syscalls_per_op", (double)sysio::snapshot().since(before).total() / state.iterations);
+}
+BENCHMARK(getch_poll);
+
+// One frame of the real main loop: the getch() polls of one MOVE_DELAY at
+// the 5 ms poll interval, a tick, and refresh() through a counted file
+// descriptor (/dev/null), reporting the system calls it took
+static void scenario_main_loop_frame(BenchState& state) {
+    const int POLLS_PER_FRAME = 100 / 5;
+    IdleTerminal terminal;
+    if (!terminal.ok()) {
+        state.skip(terminal.error());
+        return;
+    }
+    ScopedWindow window(24, 80);
+    int null_fd = open("/dev/null", O_WRONLY);
+    sysio::FdBuffer null_fd_buffer(null_fd);
+    std::ostream null_fd_stream(&null_fd_buffer);
+    std::ostream& previous = ui.set_output(null_fd_stream);
+    Snake snake(8, 2, '@');
+    Food apple('O', 10, 14, SEED);
+    const int directions[] = {KEY_RIGHT, KEY_DOWN, KEY_LEFT, KEY_UP};
+
+    int seen = 0;
+    sysio::Snapshot before = sysio::snapshot();
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        for (int poll = 0; poll < POLLS_PER_FRAME; ++poll) seen += ui.getch() != ERR;
+        game_tick(snake, apple, directions[(i / 8) % 4], 10, 14);
+        ui.refresh();
+    }
+    state.stop();
+    do_not_optimize(seen);
+    sysio::Snapshot calls = sysio::snapshot().since(before);
+    state.counter("syscalls_per_frame", (double)calls.total() / state.iterations);
+    state.counter("writes_per_frame", (double)calls.calls[sysio::WRITE] / state.iterations);
+
+    ui.set_output(previous);
+    close(null_fd);
+}
+BENCHMARK(scenario_main_loop_frame);
+
+// What the journal adds to a tick: the append on the game thread while the
+// flusher writes and syncs a scratch file behind it
+static void journal_record(BenchState& state) {
+    char path[] = "/tmp/snake_journal_XXXXXX";
+    int scratch = mkstemp(path);
+    if (scratch < 0) {
+        state.skip(std::string("cannot create a scratch file: ") + strerror(errno));
+        return;
+    }
+    close(scratch);
+    Journal journal;
+    if (!journal.create(path, make_replay_header(SEED, 24, 80, 2, 8, 10, 14))) {
+        state.skip(std::string("cannot open a journal on ") + path);
+        unlink(path);
+        return;
+    }
+    const int directions[] = {KEY_RIGHT, KEY_DOWN, KEY_LEFT, KEY_UP};
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        journal.record(directions[(i / 8) % 4]);
+    }
+    state.stop();
+    journal.close();
+    unlink(path);
+}
+BENCHMARK(journal_record);
+
+#include "bench_scenarios.h"
+
+static void usage() {
+    std::cerr << "usage: bench [--filter SUBSTR] [--reps N] [--warmup N] [--min-time-ms MS] [--json FILE] [--list] [--perf]\n"
+              << "             [--compare BASELINE] [--threshold PCT] [--alpha A] [--confirm N]" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    CompareOptions compare_options;
+    const char* json_path = nullptr;
+    const char* baseline_path = nullptr;
+    bool list = false;
+    bool use_perf = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) options.filter = argv[++i];
+        else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) options.repetitions = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) options.warmup = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--min-time-ms") == 0 && i + 1 < argc) options.min_time_ms = atof(argv[++i]);
+        else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) json_path = argv[++i];
+        else if (strcmp(argv[i], "--compare") == 0 && i + 1 < argc) baseline_path = argv[++i];
+        else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) compare_options.threshold_pct = atof(argv[++i]);
+        else if (strcmp(argv[i], "--alpha") == 0 && i + 1 < argc) compare_options.alpha = atof(argv[++i]);
+        else if (strcmp(argv[i], "--confirm") == 0 && i + 1 < argc) compare_options.confirm_runs = std::max(0, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--list") == 0) list = true;
+        else if (strcmp(argv[i], "--perf") == 0) use_perf = true;
+        else {
+            usage();
+            return 2;
+        }
+    }
+
+    PerfGroup perf;
+    if (use_perf) {
+        if (perf.open()) options.perf = &perf;
+        else std::cerr << "bench: hardware counters unavailable (" << strerror(errno) << "), continuing without" << std::endl;
+    }
+
+    std::vector<BaselineEntry> baseline;
+    if (baseline_path && !load_baseline(baseline_path, baseline)) {
+        std::cerr << "bench: cannot read baseline " << baseline_path << std::endl;
+        return 1;
+    }
+
+    std::vector<BenchResult> results;
+    for (const BenchCase& bench : bench_registry()) {
+        if (options.filter && !strstr(bench.name, options.filter)) continue;
+        if (list) {
+            printf("%s\n", bench.name);
+            continue;
+        }
+        results.push_back(run_benchmark(bench, options));
+    }
+    if (list) return 0;
+
+    print_table(stderr, results);
+    if (json_path) {
+        FILE* out = fopen(json_path, "w");
+        if (!out) {
+            std::cerr << "bench: cannot write " << json_path << std::endl;
+            return 1;
+        }
+        write_json(out, results, options);
+        fclose(out);
+    } else if (!baseline_path) {
+        write_json(stdout, results, options);
+    }
+
+    if (baseline_path) {
+        auto rerun = [&](const std::string& name) {
+            for (const BenchCase& bench : bench_registry()) {
+                if (name == bench.name) return run_benchmark(bench, options);
+            }
+            return BenchResult();
+        };
+        int regressions = compare_to_baseline(stdout, baseline, results, compare_options, rerun);
+        if (regressions > 0) {
+            printf("\n%d benchmark(s) regressed past their limit, in the first run and %d rerun(s)\n", regressions,
+                   compare_options.confirm_runs);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,221 @@
+#ifndef SNAKE_BENCH_H
+#define SNAKE_BENCH_H
+
+// Minimal benchmark harness
+//
+// A benchmark is a function taking a BenchState: it does its setup, then
+// times state.iterations repetitions of the operation between start() and
+// stop() (which may be called several times to exclude re-setup). The
+// runner calibrates an iteration count once per benchmark, runs warm-up
+// passes, then records one ns/op sample per repetition. With a PerfGroup
+// in the options, the timed region's IPC and miss rates become counters.
+
+#include <chrono>
+#include <vector>
+#include <string>
+#include <utility>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include "perf_counters.h"
+
+class BenchState {
+    private:
+        using Clock = std::chrono::steady_clock;
+        Clock::time_point started;
+        Clock::duration elapsed;
+        std::vector<std::pair<std::string, double>> counters;
+        PerfSample perf_before;
+        std::string skip_reason;
+    public:
+        uint64_t iterations;
+        PerfGroup* perf;           // null unless hardware counters were requested
+        PhaseCounters timed;       // counters over the start()/stop() regions
+
+        BenchState(uint64_t set_iterations, PerfGroup* set_perf = nullptr):
+            elapsed{0}, iterations{set_iterations}, perf{set_perf} {}
+
+        void start() {
+            if (perf) perf->read(perf_before);
+            started = Clock::now();
+        }
+        void stop() {
+            elapsed += Clock::now() - started;
+            PerfSample after;
+            if (perf && perf->read(after)) timed.add(perf_before, after);
+        }
+
+        // Reports a phase's IPC and miss rates as <prefix>_ipc etc.
+        void perf_counters(const char* prefix, const PhaseCounters& phase) {
+            if (!perf || !phase.count()) return;
+            std::string name = prefix;
+            counter((name + "_ipc").c_str(), phase.ipc());
+            counter((name + "_cache_mpki").c_str(), phase.cache_mpki());
+            counter((name + "_branch_mpki").c_str(), phase.branch_mpki());
+        }
+
+        // Extra per-benchmark metric, averaged over repetitions in the report
+        void counter(const char* name, double value) {
+            for (auto& entry : counters) {
+                if (entry.first == name) {
+                    entry.second = value;
+                    return;
+                }
+            }
+            counters.emplace_back(name, value);
+        }
+
+        double elapsed_ns() const { return std::chrono::duration<double, std::nano>(elapsed).count(); }
+        const std::vector<std::pair<std::string, double>>& get_counters() const { return counters; }
+
+        // For a benchmark that can't run here: it returns without timing
+        // anything and is reported as skipped, never as a result
+        void skip(const std::string& reason) { skip_reason = reason; }
+        const std::string& skipped() const { return skip_reason; }
+};
+
+// Keep the compiler from discarding a computed value
+template <typename T>
+inline void do_not_optimize(T const& value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+typedef void (*BenchFn)(BenchState&);
+
+struct BenchCase {
+    const char* name;
+    BenchFn fn;
+};
+
+inline std::vector<BenchCase>& bench_registry() {
+    static std::vector<BenchCase> cases;
+    return cases;
+}
+
+struct BenchRegistrar {
+    BenchRegistrar(const char* name, BenchFn fn) { bench_registry().push_back({name, fn}); }
+};
+
+#define BENCHMARK(fn) static BenchRegistrar fn##_registrar(#fn, fn)
+
+struct BenchResult {
+    std::string name;
+    uint64_t iterations;
+    std::vector<double> samples;   // ns per op, one per repetition
+    std::vector<std::pair<std::string, double>> counters;
+    std::string skipped;            // why it couldn't run; there are no samples then
+
+    double median() const {
+        std::vector<double> sorted = samples;
+        std::sort(sorted.begin(), sorted.end());
+        size_t n = sorted.size();
+        return n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+    }
+    double mean() const {
+        double sum = 0;
+        for (double s : samples) sum += s;
+        return sum / samples.size();
+    }
+    double stddev() const {
+        double m = mean(), sum = 0;
+        for (double s : samples) sum += (s - m) * (s - m);
+        return samples.size() > 1 ? std::sqrt(sum / (samples.size() - 1)) : 0;
+    }
+    double min() const { return *std::min_element(samples.begin(), samples.end()); }
+    double max() const { return *std::max_element(samples.begin(), samples.end()); }
+};
+
+struct BenchOptions {
+    int repetitions = 15;
+    int warmup = 2;
+    double min_time_ms = 20;
+    const char* filter = nullptr;
+    PerfGroup* perf = nullptr;
+};
+
+inline BenchResult run_benchmark(const BenchCase& bench, const BenchOptions& options) {
+    BenchResult result;
+    result.name = bench.name;
+
+    // Calibrate: grow the iteration count until one pass takes min_time
+    uint64_t iterations = 1;
+    while (true) {
+        BenchState state(iterations);
+        bench.fn(state);
+        if (!state.skipped().empty()) {
+            result.iterations = 0;
+            result.skipped = state.skipped();
+            return result;
+        }
+        double ns = state.elapsed_ns();
+        if (ns >= options.min_time_ms * 1e6 || iterations >= (1ull << 32)) break;
+        double scale = ns > 0 ? options.min_time_ms * 1e6 / ns * 1.2 : 100;
+        iterations = (uint64_t)(iterations * std::min(100.0, std::max(2.0, scale)));
+    }
+    result.iterations = iterations;
+
+    for (int i = 0; i < options.warmup; ++i) {
+        BenchState state(iterations);
+        bench.fn(state);
+    }
+
+    std::vector<std::pair<std::string, double>> totals;
+    for (int i = 0; i < options.repetitions; ++i) {
+        BenchState state(iterations, options.perf);
+        bench.fn(state);
+        state.perf_counters("run", state.timed);
+        result.samples.push_back(state.elapsed_ns() / iterations);
+        for (const auto& counter : state.get_counters()) {
+            auto it = std::find_if(totals.begin(), totals.end(),
+                                   [&](const std::pair<std::string, double>& t) { return t.first == counter.first; });
+            if (it == totals.end()) totals.push_back(counter);
+            else it->second += counter.second;
+        }
+    }
+    for (auto& total : totals) total.second /= options.repetitions;
+    result.counters = totals;
+    return result;
+}
+
+inline void write_json(FILE* out, const std::vector<BenchResult>& results, const BenchOptions& options) {
+    fprintf(out, "{\n  \"context\": {\"compiler\": \"%s\", \"repetitions\": %d, \"warmup\": %d, \"min_time_ms\": %g},\n",
+            __VERSION__, options.repetitions, options.warmup, options.min_time_ms);
+    fprintf(out, "  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        if (!r.skipped.empty()) {
+            fprintf(out, "    {\"name\": \"%s\", \"skipped\": \"%s\", \"samples\": []}%s\n", r.name.c_str(),
+                    r.skipped.c_str(), i + 1 < results.size() ? "," : "");
+            continue;
+        }
+        fprintf(out, "    {\"name\": \"%s\", \"unit\": \"ns/op\", \"iterations\": %llu, "
+                     "\"median\": %.3f, \"mean\": %.3f, \"stddev\": %.3f, \"min\": %.3f, \"max\": %.3f,\n",
+                r.name.c_str(), (unsigned long long)r.iterations, r.median(), r.mean(), r.stddev(), r.min(), r.max());
+        fprintf(out, "     \"samples\": [");
+        for (size_t s = 0; s < r.samples.size(); ++s) fprintf(out, "%s%.3f", s ? ", " : "", r.samples[s]);
+        fprintf(out, "],\n     \"counters\": {");
+        for (size_t c = 0; c < r.counters.size(); ++c) {
+            fprintf(out, "%s\"%s\": %.6g", c ? ", " : "", r.counters[c].first.c_str(), r.counters[c].second);
+        }
+        fprintf(out, "}}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+inline void print_table(FILE* out, const std::vector<BenchResult>& results) {
+    fprintf(out, "%-32s %12s %12s %12s %8s\n", "benchmark", "median ns", "min ns", "stddev", "cv %");
+    for (const auto& r : results) {
+        if (!r.skipped.empty()) {
+            fprintf(out, "%-32s skipped: %s\n", r.name.c_str(), r.skipped.c_str());
+            continue;
+        }
+        fprintf(out, "%-32s %12.2f %12.2f %12.2f %8.2f", r.name.c_str(), r.median(), r.min(), r.stddev(),
+                r.mean() > 0 ? 100 * r.stddev() / r.mean() : 0);
+        for (const auto& counter : r.counters) fprintf(out, "  %s=%.4g", counter.first.c_str(), counter.second);
+        fprintf(out, "\n");
+    }
+}
+
+#endif // SNAKE_BENCH_H
@@ -0,0 +1,184 @@
+#ifndef SNAKE_BENCH_COMPARE_H
+#define SNAKE_BENCH_COMPARE_H
+
+// Regression gate against a stored baseline
+//
+// The baseline is a JSON file previously written by `bench --json`. Each
+// benchmark present in both runs is compared with a one-sided Mann-Whitney
+// U test over the per-repetition samples; it is flagged when the slowdown
+// is statistically significant AND the median moved by more than the
+// threshold. The threshold is raised for benchmarks whose own baseline
+// repetitions were spread wide (noise_iqrs times their interquartile
+// range), and a flagged benchmark is run again confirm_runs times: it only
+// counts as a regression if every rerun is flagged too. A machine that
+// slows down for a few seconds then shows up as "noise", not as a failure.
+
+#include "bench.h"
+#include <fstream>
+#include <sstream>
+
+struct BaselineEntry {
+    std::string name;
+    std::vector<double> samples;
+};
+
+// Reads the subset of our own JSON output the comparison needs
+inline bool load_baseline(const char* path, std::vector<BaselineEntry>& entries) {
+    std::ifstream file(path);
+    if (!file) return false;
+    std::stringstream contents;
+    contents << file.rdbuf();
+    const std::string text = contents.str();
+
+    size_t at = 0;
+    while ((at = text.find("\"name\": \"", at)) != std::string::npos) {
+        at += 9;
+        size_t name_end = text.find('"', at);
+        size_t samples = text.find("\"samples\": [", name_end);
+        if (name_end == std::string::npos || samples == std::string::npos) return false;
+        size_t samples_end = text.find(']', samples);
+        if (samples_end == std::string::npos) return false;
+
+        BaselineEntry entry;
+        entry.name = text.substr(at, name_end - at);
+        const char* cursor = text.c_str() + samples + 12;
+        const char* end = text.c_str() + samples_end;
+        while (cursor < end) {
+            char* next;
+            double value = strtod(cursor, &next);
+            if (next == cursor) {
+                cursor++;
+                continue;
+            }
+            entry.samples.push_back(value);
+            cursor = next;
+        }
+        entries.push_back(entry);
+        at = samples_end;
+    }
+    return true;
+}
+
+// One-sided p-value that `current` tends to be larger (slower) than
+// `baseline`, using the normal approximation with tie correction
+inline double mann_whitney_p_slower(const std::vector<double>& baseline, const std::vector<double>& current) {
+    size_t n1 = current.size(), n2 = baseline.size();
+    if (n1 == 0 || n2 == 0) return 1.0;
+
+    std::vector<std::pair<double, int>> pooled;
+    for (double v : current) pooled.emplace_back(v, 0);
+    for (double v : baseline) pooled.emplace_back(v, 1);
+    std::sort(pooled.begin(), pooled.end());
+
+    // Average ranks over ties
+    double rank_sum = 0, tie_term = 0;
+    size_t n = pooled.size();
+    for (size_t i = 0; i < n;) {
+        size_t j = i;
+        while (j < n && pooled[j].first == pooled[i].first) j++;
+        double rank = (i + 1 + j) / 2.0;
+        double ties = j - i;
+        tie_term += ties * ties * ties - ties;
+        for (size_t k = i; k < j; ++k) {
+            if (pooled[k].second == 0) rank_sum += rank;
+        }
+        i = j;
+    }
+
+    double u = rank_sum - n1 * (n1 + 1) / 2.0;
+    double mean = n1 * n2 / 2.0;
+    double variance = n1 * n2 / 12.0 * ((n + 1) - tie_term / (n * (n - 1.0)));
+    if (variance <= 0) return 1.0;
+    double z = (u - mean - 0.5) / std::sqrt(variance);
+    return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+struct CompareOptions {
+    double threshold_pct = 10.0;
+    double alpha = 0.01;
+    double noise_iqrs = 2.0;    // the threshold is at least this many baseline IQRs
+    int confirm_runs = 2;       // reruns a flagged benchmark must also fail
+};
+
+// Interquartile range of the samples as a percentage of their median
+inline double spread_pct(const std::vector<double>& samples) {
+    std::vector<double> sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+    size_t n = sorted.size();
+    double median = n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+    return median > 0 ? 100.0 * (sorted[3 * n / 4] - sorted[n / 4]) / median : 0;
+}
+
+enum Verdict { SAME, REGRESSED, IMPROVED };
+
+struct Comparison {
+    double before;
+    double now;
+    double delta;       // % change of the median
+    double limit;       // % the median may move before it counts
+    double p;
+    Verdict verdict;
+};
+
+inline Comparison compare_samples(const std::vector<double>& baseline, const BenchResult& result,
+                                  const CompareOptions& options) {
+    BenchResult base;
+    base.samples = baseline;
+    Comparison c;
+    c.before = base.median();
+    c.now = result.median();
+    c.delta = c.before > 0 ? 100.0 * (c.now - c.before) / c.before : 0;
+    c.limit = std::max(options.threshold_pct, options.noise_iqrs * spread_pct(baseline));
+    double p_slower = mann_whitney_p_slower(baseline, result.samples);
+    double p_faster = mann_whitney_p_slower(result.samples, baseline);
+    c.p = p_slower;
+    c.verdict = SAME;
+    if (c.delta > c.limit && p_slower < options.alpha) {
+        c.verdict = REGRESSED;
+    } else if (c.delta < -c.limit && p_faster < options.alpha) {
+        c.verdict = IMPROVED;
+        c.p = p_faster;
+    }
+    return c;
+}
+
+// Prints the delta table; returns the number of regressions. rerun(name)
+// runs a benchmark again and returns its BenchResult.
+template <typename Rerun>
+inline int compare_to_baseline(FILE* out, const std::vector<BaselineEntry>& baseline,
+                               const std::vector<BenchResult>& results, const CompareOptions& options, Rerun&& rerun) {
+    int regressions = 0;
+    fprintf(out, "%-32s %12s %12s %9s %9s %9s  %s\n", "benchmark", "base ns", "now ns", "delta %", "limit %", "p",
+            "verdict");
+    for (const BenchResult& result : results) {
+        if (!result.skipped.empty()) {
+            fprintf(out, "%-32s skipped: %s\n", result.name.c_str(), result.skipped.c_str());
+            continue;
+        }
+        auto it = std::find_if(baseline.begin(), baseline.end(),
+                               [&](const BaselineEntry& e) { return e.name == result.name; });
+        if (it == baseline.end() || it->samples.empty()) {
+            fprintf(out, "%-32s %12s %12.2f %9s %9s %9s  new\n", result.name.c_str(), "-", result.median(), "-", "-",
+                    "-");
+            continue;
+        }
+
+        Comparison c = compare_samples(it->samples, result, options);
+        const char* verdict = c.verdict == REGRESSED ? "REGRESSED" : c.verdict == IMPROVED ? "improved" : "same";
+        if (c.verdict == REGRESSED) {
+            int confirmed = 0;
+            while (confirmed < options.confirm_runs) {
+                BenchResult again = rerun(result.name);
+                if (!again.skipped.empty() || compare_samples(it->samples, again, options).verdict != REGRESSED) break;
+                confirmed++;
+            }
+            if (confirmed == options.confirm_runs) regressions++;
+            else verdict = "noise";     // did not happen again
+        }
+        fprintf(out, "%-32s %12.2f %12.2f %+9.1f %9.1f %9.4f  %s\n", result.name.c_str(), c.before, c.now, c.delta,
+                c.limit, c.p, verdict);
+    }
+    return regressions;
+}
+
+#endif // SNAKE_BENCH_COMPARE_H
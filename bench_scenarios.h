@@ -0,0 +1,362 @@
+#ifndef SNAKE_BENCH_SCENARIOS_H
+#define SNAKE_BENCH_SCENARIOS_H
+
+// End-to-end scenarios with pathological board states
+//
+// One iteration is one frame: input, game_tick() for every snake, then a
+// refresh() into a byte-counting sink. Each scenario reports ticks_per_sec
+// and bytes_per_frame alongside the ns/op timing, and with --perf the IPC
+// and miss rates of the tick and render phases separately.
+
+#include "curses.h"
+#include "snake.h"
+#include "replay.h"
+#include "board.h"
+#include "game.h"
+#include "bench.h"
+
+// Counts everything written to it
+class CountingBuffer : public std::streambuf {
+    private:
+        uint64_t bytes = 0;
+    protected:
+        int overflow(int ch) override {
+            bytes++;
+            return ch;
+        }
+        std::streamsize xsputn(const char*, std::streamsize count) override {
+            bytes += count;
+            return count;
+        }
+    public:
+        uint64_t count() const { return bytes; }
+};
+
+// Off-screen window plus counting output for the duration of a scenario
+class ScenarioScreen {
+    private:
+        WINDOW* window;
+        WINDOW* previous;
+        CountingBuffer counter;
+        std::ostream sink;
+        std::ostream& terminal;
+    public:
+        ScenarioScreen(int height, int width):
+            window{ui.newwin(height, width, 0, 0)}, previous{ui.use_window(window)}, sink{&counter},
+            terminal{ui.set_output(sink)} {}
+        ~ScenarioScreen() {
+            ui.set_output(terminal);
+            ui.use_window(previous);
+            ui.delwin(window);
+        }
+        uint64_t bytes() const { return counter.count(); }
+};
+
+// Hardware counters for the two phases of a frame
+struct FramePhases {
+    PhaseCounters tick;
+    PhaseCounters render;
+};
+
+static void report_frames(BenchState& state, const ScenarioScreen& screen, uint64_t bytes_before,
+                          const FramePhases& phases) {
+    state.perf_counters("tick", phases.tick);
+    state.perf_counters("render", phases.render);
+    double seconds = state.elapsed_ns() / 1e9;
+    state.counter("ticks_per_sec", seconds > 0 ? state.iterations / seconds : 0);
+    state.counter("bytes_per_frame", (double)(screen.bytes() - bytes_before) / state.iterations);
+}
+
+static void render(BenchState& state, FramePhases& phases) {
+    PerfPhase phase(state.perf, phases.render);
+    ui.refresh();
+}
+
+// The first step of the shortest way, which on a torus may be over an edge
+static int direction_between(int from_y, int from_x, int to_y, int to_x, const Topology& topology = Topology()) {
+    int dy = topology.delta_y(from_y, to_y), dx = topology.delta_x(from_x, to_x);
+    if (dy < 0) return KEY_UP;
+    if (dy > 0) return KEY_DOWN;
+    return dx > 0 ? KEY_RIGHT : KEY_LEFT;
+}
+
+// Turns towards `want` the way a player would: a reversal isn't possible,
+// so it goes round instead
+static int steer(int want, int direction) {
+    bool reverse = (want == KEY_LEFT && direction == KEY_RIGHT) || (want == KEY_RIGHT && direction == KEY_LEFT) ||
+                   (want == KEY_UP && direction == KEY_DOWN) || (want == KEY_DOWN && direction == KEY_UP);
+    if (!reverse) return want;
+    return direction == KEY_LEFT || direction == KEY_RIGHT ? KEY_DOWN : KEY_RIGHT;
+}
+
+// Apple parked off the board so game_tick() never eats
+static const int NO_FOOD = -1;
+
+// A snake covering 99% of the board, following a Hamiltonian cycle
+static void scenario_full_board_99(BenchState& state) {
+    const int ROWS = 40, COLS = 40;  // cells; columns are two characters apart
+    ScenarioScreen screen(ROWS, COLS * 2);
+
+    // Column 0 is the way back up, the rest is a boustrophedon
+    std::vector<std::array<int, 2>> cycle;
+    for (int row = 0; row < ROWS; ++row) {
+        for (int c = 1; c < COLS; ++c) {
+            int col = row % 2 == 0 ? c : COLS - c;
+            cycle.push_back({row, col * 2});
+        }
+    }
+    for (int row = ROWS - 1; row >= 0; --row) cycle.push_back({row, 0});
+
+    // Starting at the fourth cell puts the starting tail on the first three
+    size_t at = 3;
+    Snake snake(cycle[at][1], cycle[at][0], '@');
+    Food apple('O', NO_FOOD, NO_FOOD, 42);
+    size_t length = cycle.size() * 99 / 100;
+    for (; at + 1 < length; ++at) {
+        const auto& from = cycle[at];
+        const auto& to = cycle[at + 1];
+        switch (direction_between(from[0], from[1], to[0], to[1])) {
+            case KEY_UP: snake.add_up(); break;
+            case KEY_DOWN: snake.add_down(); break;
+            case KEY_RIGHT: snake.add_right(); break;
+            case KEY_LEFT: snake.add_left(); break;
+        }
+    }
+
+    FramePhases phases;
+    uint64_t bytes_before = screen.bytes();
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        const auto& from = cycle[at % cycle.size()];
+        const auto& to = cycle[(at + 1) % cycle.size()];
+        at++;
+        {
+            PerfPhase phase(state.perf, phases.tick);
+            game_tick(snake, apple, direction_between(from[0], from[1], to[0], to[1]), NO_FOOD, NO_FOOD);
+        }
+        render(state, phases);
+    }
+    state.stop();
+    report_frames(state, screen, bytes_before, phases);
+}
+BENCHMARK(scenario_full_board_99);
+
+// The largest terminal we expect to meet
+static void scenario_max_terminal(BenchState& state) {
+    const int HEIGHT = 300, WIDTH = 1000;
+    ScenarioScreen screen(HEIGHT, WIDTH);
+    Snake snake(8, 2, '@');
+    Food apple('O', 10, HEIGHT - 10, 42);
+    const int directions[] = {KEY_RIGHT, KEY_DOWN, KEY_LEFT, KEY_UP};
+
+    FramePhases phases;
+    uint64_t bytes_before = screen.bytes();
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        {
+            PerfPhase phase(state.perf, phases.tick);
+            game_tick(snake, apple, directions[(i / 16) % 4], 10, HEIGHT - 10);
+        }
+        render(state, phases);
+    }
+    state.stop();
+    report_frames(state, screen, bytes_before, phases);
+}
+BENCHMARK(scenario_max_terminal);
+
+// The player reverses direction on every tick
+static void scenario_direction_flips(BenchState& state) {
+    ScenarioScreen screen(24, 80);
+    Snake snake(40, 12, '@');
+    Food apple('O', 10, 14, 42);
+
+    FramePhases phases;
+    uint64_t bytes_before = screen.bytes();
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        {
+            PerfPhase phase(state.perf, phases.tick);
+            game_tick(snake, apple, i % 2 ? KEY_LEFT : KEY_RIGHT, 10, 14);
+        }
+        render(state, phases);
+    }
+    state.stop();
+    report_frames(state, screen, bytes_before, phases);
+}
+BENCHMARK(scenario_direction_flips);
+
+// Each apple appears on the cell the tail has just left and the snake heads
+// straight for it, so it spends the run chasing its own tail and growing
+static void scenario_food_next_to_tail(BenchState& state) {
+    const int HEIGHT = 60, WIDTH = 200;
+    const uint64_t RESET_EVERY = 2048;
+    ScenarioScreen screen(HEIGHT, WIDTH);
+
+    FramePhases phases;
+    uint64_t bytes_before = screen.bytes();
+    uint64_t done = 0;
+    while (done < state.iterations) {
+        Snake snake(WIDTH / 2, HEIGHT / 2, '@');
+        Food apple('O', NO_FOOD, NO_FOOD, 42);
+        apple.place_at(snake.body().back()[0], snake.body().back()[1] - 2);
+        int direction = KEY_RIGHT;
+        uint64_t batch = std::min(RESET_EVERY, state.iterations - done);
+        state.start();
+        for (uint64_t i = 0; i < batch; ++i) {
+            {
+                PerfPhase phase(state.perf, phases.tick);
+                std::array<int, 2> back = snake.body().back();
+                direction = steer(direction_between(snake.get_y(), snake.get_x(), apple.get_y(), apple.get_x()),
+                                  direction);
+                game_tick(snake, apple, direction, NO_FOOD, NO_FOOD);
+                // An eaten apple is put off the board; the next goes on the
+                // cell the tail has just left
+                if (apple.get_y() == NO_FOOD) apple.place_at(back[0], back[1]);
+            }
+            render(state, phases);
+        }
+        state.stop();
+        done += batch;
+    }
+    report_frames(state, screen, bytes_before, phases);
+}
+BENCHMARK(scenario_food_next_to_tail);
+
+// Ten thousand snakes ticking in one world
+static void scenario_snakes_10000(BenchState& state) {
+    const int HEIGHT = 400, WIDTH = 1000, SNAKES = 10000;
+    ScenarioScreen screen(HEIGHT, WIDTH);
+    std::vector<Snake> snakes;
+    snakes.reserve(SNAKES);
+    for (int i = 0; i < SNAKES; ++i) {
+        snakes.emplace_back(8 + (i % 100) * 10, 2 + (i / 100) * 4, '@');
+    }
+    Food apple('O', NO_FOOD, NO_FOOD, 42);
+    const int directions[] = {KEY_RIGHT, KEY_DOWN, KEY_LEFT, KEY_UP};
+
+    FramePhases phases;
+    uint64_t bytes_before = screen.bytes();
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        {
+            PerfPhase phase(state.perf, phases.tick);
+            int direction = directions[i % 4];
+            for (auto& snake : snakes) game_tick(snake, apple, direction, NO_FOOD, NO_FOOD);
+        }
+        render(state, phases);
+    }
+    state.stop();
+    report_frames(state, screen, bytes_before, phases);
+}
+BENCHMARK(scenario_snakes_10000);
+
+// A player who heads straight for each apple, recorded as a replay
+static std::vector<uint8_t> greedy_replay(const ReplayHeader& header, int ticks) {
+    ReplaySim sim(header);
+    std::vector<uint8_t> moves;
+    int direction = KEY_RIGHT;
+    for (int i = 0; i < ticks; ++i) {
+        direction = steer(direction_between(sim.get_y(), sim.get_x(), sim.get_food_y(), sim.get_food_x(),
+                                            sim.get_topology()), direction);
+        moves.push_back(encode_direction(direction));
+        sim.step(direction);
+    }
+    return moves;
+}
+
+// The game's own tick (see game.h) with a number of ghosts, drawn as they
+// move. Ghosts restart every RUN_TICKS so their length stays what a few
+// minutes of play gives rather than growing with the iteration count.
+static void run_with_ghosts(BenchState& state, int count) {
+    const int HEIGHT = 24, WIDTH = 80;
+    const uint64_t RUN_TICKS = 512;
+    ScenarioScreen screen(HEIGHT, WIDTH);
+    Game game(2, 8, 10, HEIGHT - 10, 42);
+    std::vector<ReplayHeader> headers;
+    std::vector<std::vector<uint8_t>> replays;
+    for (int g = 0; g < count; ++g) {
+        headers.push_back(make_replay_header(1000 + g, HEIGHT, WIDTH, 2 + g % 8, 8 + 2 * g, 10, HEIGHT - 10));
+        replays.push_back(greedy_replay(headers.back(), RUN_TICKS));
+    }
+    const int directions[] = {KEY_RIGHT, KEY_DOWN, KEY_LEFT, KEY_UP};
+
+    FramePhases phases;
+    uint64_t bytes_before = screen.bytes();
+    uint64_t done = 0;
+    while (done < state.iterations) {
+        for (int g = 0; g < count; ++g) game.ghosts.add(headers[g], replays[g]);
+        uint64_t batch = std::min(RUN_TICKS, state.iterations - done);
+        state.start();
+        for (uint64_t i = 0; i < batch; ++i) {
+            {
+                PerfPhase phase(state.perf, phases.tick);
+                game.direction = directions[((done + i) / 8) % 4];
+                game.tick(1);
+            }
+            render(state, phases);
+        }
+        state.stop();
+        game.ghosts.clear();
+        done += batch;
+    }
+    report_frames(state, screen, bytes_before, phases);
+}
+
+// Baseline for scenario_ghosts_20: the same frame without ghosts
+static void scenario_ghosts_0(BenchState& state) {
+    run_with_ghosts(state, 0);
+}
+BENCHMARK(scenario_ghosts_0);
+
+// Racing twenty earlier runs
+static void scenario_ghosts_20(BenchState& state) {
+    run_with_ghosts(state, 20);
+}
+BENCHMARK(scenario_ghosts_20);
+
+// The headless engine with walls and self-collision, as replay_stats runs
+// it. One iteration is one tick of a lap around the top of the board that
+// stays clear of the apple, so no game ends early.
+template <bool Wrap = false, typename Board>
+static void run_on_board(BenchState& state, const Board& board) {
+    const int RUNS[4][2] = {{KEY_RIGHT, 35}, {KEY_DOWN, 5}, {KEY_LEFT, 35}, {KEY_UP, 5}};
+    ReplayHeader header = make_replay_header(SEED, board.height, board.width, 2, 8, 10, board.height - 10,
+                                             Wrap ? REPLAY_WRAP : 0);
+    std::vector<uint8_t> moves;
+    while (moves.size() < 4096) {
+        for (const auto& run : RUNS) moves.insert(moves.end(), run[1], encode_direction(run[0]));
+    }
+    BoardScratch scratch;
+    uint64_t done = 0, deaths = 0;
+    while (done < state.iterations) {
+        BoardSim<Board, Wrap> sim(board, header, scratch);
+        uint64_t batch = std::min((uint64_t)moves.size(), state.iterations - done);
+        state.start();
+        for (uint64_t tick = 0; tick < batch; ++tick) {
+            deaths += sim.step(decode_direction(moves[tick])) != ALIVE;
+        }
+        state.stop();
+        done += batch;
+    }
+    do_not_optimize(deaths);
+}
+
+// Against board_dynamic_80x24: the same ticks with the size known up front
+static void board_fixed_80x24(BenchState& state) {
+    run_on_board(state, FixedBoard<80, 24>());
+}
+BENCHMARK(board_fixed_80x24);
+
+static void board_dynamic_80x24(BenchState& state) {
+    run_on_board(state, DynamicBoard(24, 80));
+}
+BENCHMARK(board_dynamic_80x24);
+
+// Against board_fixed_80x24: the same lap with the edges wrapped, which
+// every step pays for whether it crosses one or not
+static void board_wrap_80x24(BenchState& state) {
+    run_on_board<true>(state, FixedBoard<80, 24>());
+}
+BENCHMARK(board_wrap_80x24);
+
+#endif // SNAKE_BENCH_SCENARIOS_H
@@ -0,0 +1,326 @@
+#ifndef SNAKE_BODY_STORAGE_H
+#define SNAKE_BODY_STORAGE_H
+
+// Storage policies for a snake's body
+//
+// BasicTail and BasicSnake take one of these as a template parameter, so a
+// build can pick the layout that suits its board size and snake length.
+// Every policy is a double-ended queue of {y, x} cells with the same
+// interface:
+//
+//   push_front(cell), push_back(cell), pop_back(), clear(), reserve(n),
+//   set_topology(t), front(), back(), at(i) counting from the front, size()
+//
+// The accessors return a cell by value or by const reference; callers take
+// them as `const auto&` and either works.
+//
+//   BodyRing   cells in one power-of-two ring; the default
+//   DequeBody  std::deque, as Tail used to be
+//   SoABody    the ring with rows and columns in separate arrays
+//   ChainBody  the two end cells and a 2-bit link per segment
+//
+// Neighbouring body cells are always one row or two columns apart, or
+// that far across a wrapped edge (see topology.h), so the step from one
+// to the next fits in two bits. BodyChain is a body in that form: the
+// front cell plus the links, 32 to a 64-bit word, or about 2.5 KB for
+// 10,000 segments. It is what journal checkpoints store, so it is also
+// what their record checksums cover.
+
+#include "topology.h"
+#include <array>
+#include <cassert>
+#include <deque>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Double-ended queue of body cells in a power-of-two ring. Unlike
+// std::deque it keeps its storage when the snake just moves, so a
+// steady-state tick never allocates; it only grows when the snake does.
+class BodyRing {
+    private:
+        std::vector<std::array<int, 2>> cells;
+        size_t head;    // index of front()
+        size_t count;
+
+        void grow() {
+            std::vector<std::array<int, 2>> bigger(cells.size() * 2);
+            for (size_t i = 0; i < count; ++i) bigger[i] = cells[(head + i) & (cells.size() - 1)];
+            cells.swap(bigger);
+            head = 0;
+        }
+    public:
+        BodyRing(size_t capacity = 64): head(0), count(0) {
+            size_t size = 1;
+            while (size < capacity) size *= 2;
+            cells.resize(size);
+        }
+
+        void push_front(const std::array<int, 2>& cell) {
+            if (count == cells.size()) grow();
+            head = (head - 1) & (cells.size() - 1);
+            cells[head] = cell;
+            count++;
+        }
+        void push_back(const std::array<int, 2>& cell) {
+            if (count == cells.size()) grow();
+            cells[(head + count) & (cells.size() - 1)] = cell;
+            count++;
+        }
+        void pop_back() { count--; }
+        void clear() { count = 0; }
+        // Cells are stored as they are, edges or not
+        void set_topology(const Topology&) {}
+
+        // Grow up front so later pushes never reallocate
+        void reserve(size_t capacity) {
+            while (cells.size() < capacity) grow();
+        }
+
+        const std::array<int, 2>& front() const { return cells[head]; }
+        // i counts from the front
+        const std::array<int, 2>& at(size_t i) const { return cells[(head + i) & (cells.size() - 1)]; }
+        const std::array<int, 2>& back() const { return cells[(head + count - 1) & (cells.size() - 1)]; }
+        size_t size() const { return count; }
+};
+
+class DequeBody {
+    private:
+        std::deque<std::array<int, 2>> cells;
+    public:
+        void push_front(const std::array<int, 2>& cell) { cells.push_front(cell); }
+        void push_back(const std::array<int, 2>& cell) { cells.push_back(cell); }
+        void pop_back() { cells.pop_back(); }
+        void clear() { cells.clear(); }
+        void set_topology(const Topology&) {}
+        // A deque can't set aside room ahead of time
+        void reserve(size_t) {}
+
+        const std::array<int, 2>& front() const { return cells.front(); }
+        const std::array<int, 2>& at(size_t i) const { return cells[i]; }
+        const std::array<int, 2>& back() const { return cells.back(); }
+        size_t size() const { return cells.size(); }
+};
+
+// BodyRing with the rows and the columns in arrays of their own, for code
+// that reads only one coordinate or wants it contiguous
+class SoABody {
+    private:
+        std::vector<int> rows;
+        std::vector<int> columns;
+        size_t head;    // index of front()
+        size_t count;
+
+        size_t slot(size_t i) const { return (head + i) & (rows.size() - 1); }
+
+        void grow() {
+            std::vector<int> bigger_rows(rows.size() * 2), bigger_columns(rows.size() * 2);
+            for (size_t i = 0; i < count; ++i) {
+                bigger_rows[i] = rows[slot(i)];
+                bigger_columns[i] = columns[slot(i)];
+            }
+            rows.swap(bigger_rows);
+            columns.swap(bigger_columns);
+            head = 0;
+        }
+    public:
+        SoABody(size_t capacity = 64): head(0), count(0) {
+            size_t size = 1;
+            while (size < capacity) size *= 2;
+            rows.resize(size);
+            columns.resize(size);
+        }
+
+        void push_front(const std::array<int, 2>& cell) {
+            if (count == rows.size()) grow();
+            head = (head - 1) & (rows.size() - 1);
+            rows[head] = cell[0];
+            columns[head] = cell[1];
+            count++;
+        }
+        void push_back(const std::array<int, 2>& cell) {
+            if (count == rows.size()) grow();
+            rows[slot(count)] = cell[0];
+            columns[slot(count)] = cell[1];
+            count++;
+        }
+        void pop_back() { count--; }
+        void clear() { count = 0; }
+        void set_topology(const Topology&) {}
+
+        void reserve(size_t capacity) {
+            while (rows.size() < capacity) grow();
+        }
+
+        std::array<int, 2> front() const { return at(0); }
+        std::array<int, 2> at(size_t i) const { return {rows[slot(i)], columns[slot(i)]}; }
+        std::array<int, 2> back() const { return at(count - 1); }
+        size_t size() const { return count; }
+};
+
+// The step from a body cell to the next one back
+enum Link { LINK_UP, LINK_DOWN, LINK_LEFT, LINK_RIGHT };
+
+// False if the cells are not neighbours
+inline bool link_between(const std::array<int, 2>& from, const std::array<int, 2>& to, int& link,
+                         const Topology& topology = Topology()) {
+    int dy = topology.delta_y(from[0], to[0]), dx = topology.delta_x(from[1], to[1]);
+    if (dx == 0 && dy == -1) link = LINK_UP;
+    else if (dx == 0 && dy == 1) link = LINK_DOWN;
+    else if (dy == 0 && dx == -2) link = LINK_LEFT;
+    else if (dy == 0 && dx == 2) link = LINK_RIGHT;
+    else return false;
+    return true;
+}
+
+inline std::array<int, 2> follow_link(const std::array<int, 2>& from, int link, const Topology& topology = Topology()) {
+    static const int DY[4] = {-1, 1, 0, 0};
+    static const int DX[4] = {0, 0, -2, 2};
+    return {topology.wrap_y(from[0] + DY[link]), topology.wrap_x(from[1] + DX[link])};
+}
+
+inline int reverse_link(int link) { return link ^ 1; }
+
+// Links packed 32 to a word in a power-of-two ring. Cells are worked out by
+// walking the links from the front, so at() is O(1) only when stepping
+// forward from the previous call, which is how bodies are read.
+// Pushed cells must neighbour the end they are pushed onto; there is no
+// link for any other step, so a push that breaks this fails an assertion.
+class ChainBody {
+    private:
+        std::vector<uint64_t> words;
+        size_t first_link;      // ring slot of the link behind front()
+        size_t count;           // cells; there are count - 1 links
+        std::array<int, 2> first;
+        std::array<int, 2> last;
+        Topology topology;
+        mutable size_t cursor;  // at() resumes its walk from here
+        mutable std::array<int, 2> cursor_cell;
+
+        size_t slots() const { return words.size() * 32; }
+        size_t slot(size_t k) const { return (first_link + k) & (slots() - 1); }
+
+        int link(size_t k) const {
+            size_t at = slot(k);
+            return (int)(words[at / 32] >> (at % 32 * 2)) & 3;
+        }
+
+        void set_link(size_t at, int code) {
+            uint64_t& word = words[at / 32];
+            word = (word & ~(3ull << (at % 32 * 2))) | ((uint64_t)code << (at % 32 * 2));
+        }
+
+        void grow() {
+            std::vector<uint64_t> bigger(words.size() * 2);
+            for (size_t k = 0; k + 1 < count; ++k) {
+                bigger[k / 32] |= (uint64_t)link(k) << (k % 32 * 2);
+            }
+            words.swap(bigger);
+            first_link = 0;
+        }
+
+        void rewind() const {
+            cursor = 0;
+            cursor_cell = first;
+        }
+    public:
+        ChainBody(size_t capacity = 64): first_link(0), count(0), first{0, 0}, last{0, 0}, cursor(0), cursor_cell{0, 0} {
+            size_t size = 1;
+            while (size * 32 < capacity) size *= 2;
+            words.resize(size);
+        }
+
+        void push_front(const std::array<int, 2>& cell) {
+            if (count > 0) {
+                if (count - 1 == slots()) grow();
+                int code = LINK_UP;
+                bool linked = link_between(cell, first, code, topology);
+                assert(linked && "ChainBody::push_front: cell is not next to the front");
+                (void)linked;
+                first_link = (first_link - 1) & (slots() - 1);
+                set_link(first_link, code);
+            } else {
+                last = cell;
+            }
+            first = cell;
+            count++;
+            rewind();
+        }
+        void push_back(const std::array<int, 2>& cell) {
+            if (count > 0) {
+                if (count - 1 == slots()) grow();
+                int code = LINK_UP;
+                bool linked = link_between(last, cell, code, topology);
+                assert(linked && "ChainBody::push_back: cell is not next to the back");
+                (void)linked;
+                set_link(slot(count - 1), code);
+            } else {
+                first = cell;
+            }
+            last = cell;
+            count++;
+        }
+        void pop_back() {
+            if (--count > 0) last = follow_link(last, reverse_link(link(count - 1)), topology);
+            if (cursor >= count) rewind();
+        }
+        void clear() {
+            count = 0;
+            rewind();
+        }
+        // Links across a wrapped edge need the board size to follow
+        void set_topology(const Topology& set_topology) { topology = set_topology; }
+
+        void reserve(size_t capacity) {
+            while (slots() < capacity) grow();
+        }
+
+        std::array<int, 2> front() const { return first; }
+        std::array<int, 2> back() const { return last; }
+        std::array<int, 2> at(size_t i) const {
+            if (i < cursor) rewind();
+            while (cursor < i) cursor_cell = follow_link(cursor_cell, link(cursor++), topology);
+            return cursor_cell;
+        }
+        size_t size() const { return count; }
+};
+
+// A body in chain form, as checkpoints store it
+struct BodyChain {
+    std::array<int, 2> front;
+    size_t length;                  // cells
+    std::vector<uint64_t> links;    // length - 1 links from the front back
+};
+
+// False if two cells in a row are not neighbours
+template <typename Storage>
+bool to_chain(const Storage& body, BodyChain& chain, const Topology& topology = Topology()) {
+    chain.length = body.size();
+    chain.links.assign(chain.length > 1 ? (chain.length - 1 + 31) / 32 : 0, 0);
+    if (chain.length == 0) {
+        chain.front = {0, 0};
+        return true;
+    }
+    chain.front = body.at(0);
+    std::array<int, 2> previous = chain.front;
+    for (size_t i = 1; i < chain.length; ++i) {
+        std::array<int, 2> cell = body.at(i);
+        int code;
+        if (!link_between(previous, cell, code, topology)) return false;
+        chain.links[(i - 1) / 32] |= (uint64_t)code << ((i - 1) % 32 * 2);
+        previous = cell;
+    }
+    return true;
+}
+
+inline void from_chain(const BodyChain& chain, std::vector<std::array<int, 2>>& cells,
+                       const Topology& topology = Topology()) {
+    cells.resize(chain.length);
+    if (chain.length == 0) return;
+    cells[0] = chain.front;
+    for (size_t i = 1; i < chain.length; ++i) {
+        cells[i] = follow_link(cells[i - 1], (int)(chain.links[(i - 1) / 32] >> ((i - 1) % 32 * 2)) & 3, topology);
+    }
+}
+
+#endif // SNAKE_BODY_STORAGE_H
@@ -0,0 +1,307 @@
+#ifndef SNAKE_BROADCAST_H
+#define SNAKE_BROADCAST_H
+
+// Spectator broadcast server (POSIX only)
+//
+// Streams the main window to any number of local spectators over a Unix
+// socket or a TCP loopback port. Each frame is encoded once into a shared,
+// reference-counted buffer and the same buffer is queued on every subscriber,
+// then flushed with writev(). Subscribers that fall too far behind have their
+// queue dropped and resume at the next keyframe.
+//
+// Watch a game with e.g. `socat - UNIX-CONNECT:/tmp/snake.sock` or `nc 127.0.0.1 7000`.
+
+#ifndef _WIN32
+
+#include "curses.h"
+#include "sys_io.h"
+#include <memory>
+#include <deque>
+#include <climits>
+#include <cerrno>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/uio.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+class Broadcaster {
+public:
+    using Frame = std::shared_ptr<const std::string>;
+
+    struct Stats {
+        unsigned long frames = 0;
+        unsigned long keyframes = 0;
+        unsigned long bytes_encoded = 0;
+        unsigned long bytes_sent = 0;
+        unsigned long skips = 0;        // subscribers skipped forward to a keyframe
+        unsigned long disconnects = 0;
+    };
+
+private:
+    struct Subscriber {
+        int fd;
+        std::deque<Frame> pending;
+        size_t pending_bytes;
+        size_t offset;                  // bytes of pending.front() already written
+        bool awaiting_keyframe;
+    };
+
+    // A keyframe is forced at least this often so new and skipped
+    // subscribers never wait long...
+    static const int KEYFRAME_INTERVAL = 50;
+    // ...but not more often than this, so one slow reader can't turn
+    // every frame into a full redraw for everybody else.
+    static const int MIN_KEYFRAME_GAP = 10;
+    static const size_t MAX_PENDING_BYTES = 256 * 1024;
+    static const int MAX_IOV = 64;
+
+    int listen_fd;
+    std::vector<Subscriber> subscribers;
+    std::vector<char> previous;         // last published screen, row-major
+    int prev_height;
+    int prev_width;
+    int frames_since_keyframe;
+    std::string scratch;
+    Stats stats;
+
+    static bool set_nonblocking(int fd) {
+        int flags = fcntl(fd, F_GETFL, 0);
+        return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+    }
+
+    // Spectator counts in the thousands need more descriptors than the usual soft limit
+    static void raise_fd_limit() {
+        struct rlimit limit;
+        if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+            limit.rlim_cur = limit.rlim_max;
+            setrlimit(RLIMIT_NOFILE, &limit);
+        }
+    }
+
+    bool start_listening(int fd) {
+        if (fd < 0) return false;
+        if (::listen(fd, SOMAXCONN) != 0 || !set_nonblocking(fd)) {
+            close(fd);
+            return false;
+        }
+        // A spectator hanging up must not kill the game
+        signal(SIGPIPE, SIG_IGN);
+        raise_fd_limit();
+        listen_fd = fd;
+        return true;
+    }
+
+    void accept_new() {
+        if (listen_fd < 0) return;
+        while (true) {
+            int fd = accept(listen_fd, nullptr, nullptr);
+            if (fd < 0) break;
+            if (!set_nonblocking(fd)) {
+                close(fd);
+                continue;
+            }
+            subscribers.push_back({fd, {}, 0, 0, true});
+        }
+    }
+
+    static void append_cursor(std::string& out, int y, int x) {
+        char seq[32];
+        int n = snprintf(seq, sizeof(seq), "\033[%d;%dH", y + 1, x + 1);
+        out.append(seq, n);
+    }
+
+    Frame encode_keyframe(const WINDOW* win) {
+        scratch.clear();
+        scratch += "\033[H\033[2J";
+        for (int y = 0; y < win->height; ++y) {
+            scratch.append(win->buffer[y].data(), win->width);
+            scratch += "\r\n";
+        }
+        return std::make_shared<const std::string>(scratch);
+    }
+
+    // Cursor-addressed diff against the previous frame; nullptr if nothing changed
+    Frame encode_diff(const WINDOW* win) {
+        scratch.clear();
+        for (int y = 0; y < win->height; ++y) {
+            const char* row = win->buffer[y].data();
+            const char* prev_row = &previous[(size_t)y * win->width];
+            int cursor_x = -1;
+            for (int x = 0; x < win->width; ++x) {
+                if (row[x] == prev_row[x]) continue;
+                if (cursor_x != x) append_cursor(scratch, y, x);
+                scratch += row[x];
+                cursor_x = x + 1;
+            }
+        }
+        if (scratch.empty()) return nullptr;
+        return std::make_shared<const std::string>(scratch);
+    }
+
+    void remember(const WINDOW* win) {
+        previous.resize((size_t)win->height * win->width);
+        for (int y = 0; y < win->height; ++y) {
+            std::copy(win->buffer[y].begin(), win->buffer[y].end(), previous.begin() + (size_t)y * win->width);
+        }
+        prev_height = win->height;
+        prev_width = win->width;
+    }
+
+    void enqueue(Subscriber& sub, const Frame& frame, bool keyframe) {
+        if (sub.awaiting_keyframe) {
+            if (!keyframe) return;
+            sub.awaiting_keyframe = false;
+        }
+        if (sub.pending_bytes + frame->size() > MAX_PENDING_BYTES) {
+            // Too far behind: keep only a partially written frame so the
+            // stream stays well-formed, and resume at the next keyframe
+            while (sub.pending.size() > (sub.offset > 0 ? 1u : 0u)) {
+                sub.pending_bytes -= sub.pending.back()->size();
+                sub.pending.pop_back();
+            }
+            sub.awaiting_keyframe = !keyframe;
+            stats.skips++;
+            if (!keyframe) return;
+        }
+        sub.pending.push_back(frame);
+        sub.pending_bytes += frame->size();
+    }
+
+    // Returns false if the subscriber has gone away
+    bool flush(Subscriber& sub) {
+        while (!sub.pending.empty()) {
+            struct iovec iov[MAX_IOV];
+            int count = 0;
+            for (auto it = sub.pending.begin(); it != sub.pending.end() && count < MAX_IOV; ++it, ++count) {
+                size_t skip = (count == 0) ? sub.offset : 0;
+                iov[count].iov_base = const_cast<char*>((*it)->data() + skip);
+                iov[count].iov_len = (*it)->size() - skip;
+            }
+
+            ssize_t written = sysio::writev(sub.fd, iov, count);
+            if (written < 0) {
+                return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+            }
+            stats.bytes_sent += written;
+
+            size_t left = written;
+            while (left > 0) {
+                size_t remaining = sub.pending.front()->size() - sub.offset;
+                if (left < remaining) {
+                    sub.offset += left;
+                    break;
+                }
+                left -= remaining;
+                sub.pending_bytes -= sub.pending.front()->size();
+                sub.pending.pop_front();
+                sub.offset = 0;
+            }
+            if (sub.offset > 0) break;  // socket buffer full
+        }
+        return true;
+    }
+
+public:
+    Broadcaster() : listen_fd(-1), prev_height(0), prev_width(0), frames_since_keyframe(0) {}
+
+    Broadcaster(const Broadcaster&) = delete;
+    Broadcaster& operator=(const Broadcaster&) = delete;
+
+    ~Broadcaster() {
+        for (auto& sub : subscribers) close(sub.fd);
+        if (listen_fd >= 0) close(listen_fd);
+    }
+
+    bool listen_unix(const char* path) {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (strlen(path) >= sizeof(addr.sun_path)) return false;
+        strcpy(addr.sun_path, path);
+        unlink(path);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return false;
+        if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+            close(fd);
+            return false;
+        }
+        return start_listening(fd);
+    }
+
+    bool listen_tcp(int port) {
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) return false;
+        int reuse = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+            close(fd);
+            return false;
+        }
+        return start_listening(fd);
+    }
+
+    // "PATH" for a Unix socket, a bare number for a loopback TCP port
+    bool listen_on(const char* spec) {
+        char* end;
+        long port = strtol(spec, &end, 10);
+        if (*spec && *end == '\0' && port > 0 && port < 65536) return listen_tcp((int)port);
+        return listen_unix(spec);
+    }
+
+    // Encode the window once and fan it out to every subscriber
+    void publish(const WINDOW* win) {
+        if (!win) return;
+        accept_new();
+
+        bool any_waiting = false;
+        for (const auto& sub : subscribers) any_waiting |= sub.awaiting_keyframe;
+
+        frames_since_keyframe++;
+        bool keyframe = win->height != prev_height || win->width != prev_width ||
+                        frames_since_keyframe >= KEYFRAME_INTERVAL ||
+                        (any_waiting && frames_since_keyframe >= MIN_KEYFRAME_GAP);
+
+        Frame frame = keyframe ? encode_keyframe(win) : encode_diff(win);
+        remember(win);
+        if (keyframe) {
+            frames_since_keyframe = 0;
+            stats.keyframes++;
+        }
+        if (frame) {
+            stats.frames++;
+            stats.bytes_encoded += frame->size();
+        }
+
+        size_t kept = 0;
+        for (size_t i = 0; i < subscribers.size(); ++i) {
+            Subscriber& sub = subscribers[i];
+            if (frame) enqueue(sub, frame, keyframe);
+            if (!flush(sub)) {
+                close(sub.fd);
+                stats.disconnects++;
+                continue;
+            }
+            if (kept != i) subscribers[kept] = std::move(sub);
+            kept++;
+        }
+        subscribers.erase(subscribers.begin() + kept, subscribers.end());
+    }
+
+    size_t subscriber_count() const { return subscribers.size(); }
+    const Stats& get_stats() const { return stats; }
+};
+
+#endif // _WIN32
+
+#endif // SNAKE_BROADCAST_H
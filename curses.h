@@ -7,6 +7,7 @@
 #include <cstdarg>
 #include <cstring>
 #include <algorithm>
+#include "sys_io.h"
 
 // Platform-specific headers
 #ifdef _WIN32
@@ -25,6 +26,7 @@
 #define KEY_ENTER 13
 #define KEY_BACKSPACE 8
 #define KEY_ESC 27
+#define ERR (-1)
 
 class WINDOW {
 public:
@@ -44,6 +46,18 @@ class TerminalUI {
 private:
     // Current window
     WINDOW* current_window;
+
+    // Where refresh() writes the screen; by default straight to the
+    // terminal through a counted file descriptor buffer
+    #ifndef _WIN32
+        sysio::FdBuffer stdout_buffer;
+        std::ostream stdout_stream;
+    #endif
+    std::ostream* output;
+    size_t last_refresh_bytes;
+
+    // refresh() composes the frame here and writes it in one go
+    std::string frame;
     
     // Terminal mode flags
     bool is_initialized;
@@ -72,14 +86,14 @@ private:
             SetConsoleMode(console_handle, mode);
         #else
             struct termios new_termios;
-            tcgetattr(STDIN_FILENO, &old_termios);
+            sysio::tcgetattr(STDIN_FILENO, &old_termios);
             new_termios = old_termios;
             
             // Disable canonical mode and echoing
             new_termios.c_lflag &= ~(ICANON | ECHO);
             new_termios.c_cc[VMIN] = 0;
             new_termios.c_cc[VTIME] = 0;
-            tcsetattr(STDIN_FILENO, TCSANOW, &new_termios);
+            sysio::tcsetattr(STDIN_FILENO, TCSANOW, &new_termios);
         #endif
     }
 
@@ -88,7 +102,7 @@ private:
         #ifdef _WIN32
             SetConsoleMode(console_handle, old_console_mode);
         #else
-            tcsetattr(STDIN_FILENO, TCSANOW, &old_termios);
+            sysio::tcsetattr(STDIN_FILENO, TCSANOW, &old_termios);
         #endif
     }
 
@@ -159,9 +173,9 @@ public:
 
         // Clear screen
         #ifdef _WIN32
-            system("cls");
+            sysio::system("cls");
         #else
-            system("clear");
+            sysio::system("clear");
         #endif
 
         // Clean up window
@@ -183,7 +197,7 @@ public:
             height = csbi.srWindow.Bottom - csbi.srWindow.Top + 1;
         #else
             struct winsize w;
-            ioctl(STDOUT_FILENO, TIOCGWINSZ, &w);
+            sysio::ioctl_winsize(STDOUT_FILENO, &w);
             width = w.ws_col;
             height = w.ws_row;
         #endif
@@ -240,6 +254,24 @@ public:
         }
     }
 
+    // Equivalent to newwin(); off-screen until selected with use_window()
+    WINDOW* newwin(int nlines, int ncols, int begin_y, int begin_x) {
+        return new WINDOW(nlines, ncols, begin_y, begin_x);
+    }
+
+    // Equivalent to delwin()
+    void delwin(WINDOW* win) {
+        if (win == current_window) current_window = nullptr;
+        delete win;
+    }
+
+    // Direct subsequent drawing at another window; returns the previous one
+    WINDOW* use_window(WINDOW* win) {
+        WINDOW* previous = current_window;
+        current_window = win;
+        return previous;
+    }
+
     // Equivalent to mvaddch()
     void mvaddch(int y, int x, char ch) {
         if (!current_window) return;
@@ -248,27 +280,37 @@ public:
         }
     }
 
+    // Equivalent to mvinch(); ERR off the window
+    int mvinch(int y, int x) {
+        if (!current_window) return ERR;
+        if (y >= 0 && y < current_window->height && x >= 0 && x < current_window->width) {
+            return (unsigned char)current_window->buffer[y][x];
+        }
+        return ERR;
+    }
+
     // Read a character (similar to getch())
     int getch() {
         #ifdef _WIN32
             return windows_getch();  // Use Windows API input method
         #else
             char ch;
+            ssize_t got;
             // Set up non-blocking input for Unix
             struct termios old_settings, new_settings;
-            tcgetattr(STDIN_FILENO, &old_settings);
+            sysio::tcgetattr(STDIN_FILENO, &old_settings);
             new_settings = old_settings;
             new_settings.c_lflag &= ~(ICANON | ECHO);
             new_settings.c_cc[VMIN] = 0;
             new_settings.c_cc[VTIME] = 0;
-            tcsetattr(STDIN_FILENO, TCSANOW, &new_settings);
+            sysio::tcsetattr(STDIN_FILENO, TCSANOW, &new_settings);
 
             // Read character
-            read(STDIN_FILENO, &ch, 1);
+            got = sysio::read(STDIN_FILENO, &ch, 1);
 
             // Restore terminal settings
-            tcsetattr(STDIN_FILENO, TCSANOW, &old_settings);
-            return ch;
+            sysio::tcsetattr(STDIN_FILENO, TCSANOW, &old_settings);
+            return got == 1 ? (unsigned char)ch : ERR;
         #endif
     }
 
@@ -288,35 +330,63 @@ public:
         va_end(args);
 
         // Copy to screen buffer
-        std::string str(buffer);
-        for (size_t i = 0; i < str.length() && x + i < current_window->width; ++i) {
-            current_window->buffer[y][x + i] = str[i];
+        for (int i = 0; buffer[i] != '\0' && x + i < current_window->width; ++i) {
+            current_window->buffer[y][x + i] = buffer[i];
         }
     }
 
+    // Send refresh() output somewhere else; returns the previous stream
+    std::ostream& set_output(std::ostream& stream) {
+        std::ostream& previous = *output;
+        output = &stream;
+        return previous;
+    }
+
     // Refresh screen
     void refresh() {
         if (!current_window) return;
 
         // Clear console
+        frame.clear();
         #ifdef _WIN32
-            system("cls");
+            sysio::system("cls");
         #else
-            system("clear");
+            // Same bytes clear(1) prints, without spawning it every frame
+            frame += "\033[H\033[2J";
         #endif
 
-        // Print screen buffer
+        // Print screen buffer; the string keeps its capacity between frames
         for (const auto& row : current_window->buffer) {
-            for (char ch : row) {
-                std::cout << ch;
-            }
-            std::cout << std::endl;
+            frame.append(row.data(), row.size());
+            frame += '\n';
         }
+        output->write(frame.data(), frame.size());
+        output->flush();
+        last_refresh_bytes = frame.size();
+    }
+
+    // Size the frame buffer for the current window up front
+    void reserve_frame() {
+        if (!current_window) return;
+        frame.reserve(16 + current_window->buffer.size() * (current_window->width + 1));
+    }
+
+    // Bytes the last refresh() wrote
+    size_t refresh_bytes() const {
+        return last_refresh_bytes;
     }
 
     // Constructor
     TerminalUI() : 
         current_window(nullptr),
+        #ifdef _WIN32
+        output(&std::cout),
+        #else
+        stdout_buffer(STDOUT_FILENO),
+        stdout_stream(&stdout_buffer),
+        output(&stdout_stream),
+        #endif
+        last_refresh_bytes(0),
         is_initialized(false), 
         echo_mode(true), 
         nodelay_mode(false), 
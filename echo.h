@@ -0,0 +1,163 @@
+#ifndef SNAKE_ECHO_H
+#define SNAKE_ECHO_H
+
+// Temporal mode: the snake's own body from some ticks ago stays on the
+// board as a solid echo
+//
+// Rather than keep copies of the body for every past tick, a TimeGrid
+// remembers for each cell the tick it was last entered and the tick it was
+// left, so "was this cell occupied at tick t" is one lookup and the grid
+// is a fixed 8 bytes a cell however long the game runs. The price is that
+// a cell only remembers its latest visit: once it is entered again, the
+// visits before are forgotten.
+//
+// Drawing goes by the body itself instead: each tick's entered cells are
+// kept for `delay` ticks and then replayed onto a copy of the body, so the
+// echo on screen costs its length, not the board. Its cells are still
+// checked against the grid, so what is drawn is what can catch the snake.
+
+#include "curses.h"
+#include "body_storage.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+class TimeGrid {
+    private:
+        struct Visit {
+            uint32_t entered;
+            uint32_t left;
+        };
+        std::vector<Visit> cells;
+        int height;
+        int width;
+
+    public:
+        // Marks a time that hasn't come: never entered, or not left yet
+        static const uint32_t NEVER = UINT32_MAX;
+
+        TimeGrid(): height(0), width(0) {}
+
+        void reset(int set_height, int set_width) {
+            height = set_height;
+            width = set_width;
+            cells.assign((size_t)height * width, {NEVER, NEVER});
+        }
+
+        bool inside(int y, int x) const { return y >= 0 && y < height && x >= 0 && x < width; }
+
+        void enter(int y, int x, uint32_t tick) {
+            if (inside(y, x)) cells[(size_t)y * width + x] = {tick, NEVER};
+        }
+
+        void leave(int y, int x, uint32_t tick) {
+            if (inside(y, x)) cells[(size_t)y * width + x].left = tick;
+        }
+
+        bool occupied_at(int y, int x, uint32_t tick) const {
+            if (!inside(y, x)) return false;
+            const Visit& visit = cells[(size_t)y * width + x];
+            return visit.entered <= tick && tick < visit.left;
+        }
+
+        int get_height() const { return height; }
+        int get_width() const { return width; }
+};
+
+// Follows a snake tick by tick and reports when its head runs into where
+// the snake was `delay` ticks before. Works with Snake and ReplaySim alike;
+// call before() and after() around each tick.
+class Echo {
+    private:
+        // The cells one tick entered, in order; the tail always leaves one
+        struct Step {
+            std::array<int, 2> entered[2];
+            int count;
+        };
+        TimeGrid grid;
+        uint32_t delay;
+        uint32_t tick;
+        std::array<int, 2> old_back;
+        size_t old_length;
+        std::vector<Step> steps;    // ring of the last delay + 1 ticks
+        BodyRing past;              // the snake delay ticks ago, head first
+        std::vector<std::array<int, 2>> drawn;
+        char character;
+
+        // Enters a cell, true if the echo was already there
+        bool touch(int y, int x) {
+            bool hit = tick >= delay && grid.occupied_at(y, x, tick - delay);
+            grid.enter(y, x, tick);
+            return hit;
+        }
+    public:
+        Echo(char set_character = '%'): delay(0), tick(0), old_back{0, 0}, old_length(0), character(set_character) {}
+
+        // Tick 0 is the snake as it stands now
+        template <typename S>
+        void start(S& snake, int height, int width, uint32_t set_delay) {
+            grid.reset(height, width);
+            delay = set_delay;
+            tick = 0;
+            steps.assign(delay + 1, Step{});
+            past.clear();
+            grid.enter(snake.get_y(), snake.get_x(), 0);
+            past.push_back({snake.get_y(), snake.get_x()});
+            for (size_t i = 0; i < snake.body().size(); ++i) {
+                grid.enter(snake.body().at(i)[0], snake.body().at(i)[1], 0);
+                past.push_back(snake.body().at(i));
+            }
+        }
+
+        template <typename S>
+        void before(S& snake) {
+            old_back = snake.body().back();
+            old_length = snake.get_length();
+        }
+
+        // Every tick drops the old end of the tail; eating also enters the
+        // cell the head passed through on the way
+        template <typename S>
+        bool after(S& snake) {
+            tick++;
+            grid.leave(old_back[0], old_back[1], tick);
+            Step& step = steps[tick % steps.size()];
+            step.count = 0;
+            bool hit = false;
+            if (snake.get_length() > old_length) {
+                step.entered[step.count++] = snake.body().at(0);
+                hit = touch(snake.body().at(0)[0], snake.body().at(0)[1]);
+            }
+            step.entered[step.count++] = {snake.get_y(), snake.get_x()};
+            hit = touch(snake.get_y(), snake.get_x()) || hit;
+
+            // The echo catches up with the tick delay ago
+            if (tick > delay) {
+                const Step& then = steps[(tick - delay) % steps.size()];
+                past.pop_back();
+                for (int i = 0; i < then.count; ++i) past.push_front(then.entered[i]);
+            }
+            return hit;
+        }
+
+        uint32_t get_tick() const { return tick; }
+
+        // Into the blank cells of the current window; erase() puts them back
+        void draw() {
+            if (tick < delay) return;
+            uint32_t then = tick - delay;
+            for (size_t i = 0; i < past.size(); ++i) {
+                int y = past.at(i)[0], x = past.at(i)[1];
+                if (!grid.occupied_at(y, x, then) || ui.mvinch(y, x) != ' ') continue;
+                ui.mvaddch(y, x, character);
+                drawn.push_back({y, x});
+            }
+        }
+
+        void erase() {
+            for (const auto& cell : drawn) ui.mvaddch(cell[0], cell[1], ' ');
+            drawn.clear();
+        }
+};
+
+#endif // SNAKE_ECHO_H
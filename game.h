@@ -0,0 +1,165 @@
+#ifndef SNAKE_GAME_H
+#define SNAKE_GAME_H
+
+// One game in play, and the clock that paces it
+//
+// Game holds the snake, the apple and everything that follows them tick
+// by tick: the turn queue, the recording, the journal, ghosts and the
+// echo. snake.cpp and alloc_check both play through it, so the checker
+// runs the same tick and draw path as the game and keeps up with it.
+
+#include "curses.h"
+#include "snake.h"
+#include "hud.h"
+#include "replay.h"
+#include "journal.h"
+#include "echo.h"
+#include <chrono>
+
+// The simulation advances in fixed steps of game time. Frames go out every
+// interval of wall time and run however many steps are due, so a late
+// frame catches up instead of slowing the game, and speed scales game time
+// from slow motion to fast-forward.
+class FrameClock {
+    public:
+        using Clock = std::chrono::steady_clock;
+    private:
+        Clock::duration step;
+        Clock::duration interval;
+        double speed;
+        int max_steps;          // beyond this many in one frame the backlog is dropped
+        Clock::time_point last_frame;
+        Clock::time_point sim_clock;
+        std::chrono::nanoseconds sim_lag;
+    public:
+        FrameClock(Clock::duration set_step, Clock::duration set_interval, double set_speed, int set_max_steps):
+            step(set_step), interval(set_interval), speed(set_speed), max_steps(set_max_steps),
+            last_frame(Clock::now()), sim_clock(last_frame), sim_lag(0) {}
+
+        // Starts counting from now, with nothing owed
+        void restart(Clock::time_point now) {
+            last_frame = now;
+            sim_clock = now;
+            sim_lag = std::chrono::nanoseconds(0);
+        }
+
+        // When the next frame should go out
+        Clock::time_point next_frame() const { return last_frame + interval; }
+        bool frame_due(Clock::time_point now) const { return now >= next_frame(); }
+
+        // Closes the frame that is due and returns the steps it runs, which
+        // in slow motion may be none
+        int advance(Clock::time_point now) {
+            sim_lag += std::chrono::duration_cast<std::chrono::nanoseconds>((now - sim_clock) * speed);
+            sim_clock = now;
+            int steps = 0;
+            while (sim_lag >= step && steps < max_steps) {
+                sim_lag -= step;
+                steps++;
+            }
+            if (sim_lag >= step) sim_lag = std::chrono::nanoseconds(0);
+
+            // Frames keep to a fixed schedule unless a whole one was missed
+            Clock::time_point scheduled = next_frame();
+            last_frame = now - scheduled < interval ? scheduled : now;
+            return steps;
+        }
+};
+
+struct Game {
+    Snake snake;
+    Food apple;
+    int food_min;
+    int food_max;
+    int direction;
+    InputQueue turns;
+    ReplayWriter recorder;
+    GhostPack ghosts;
+    Echo echo;
+    bool echo_on;
+    bool caught;        // by the echo; the game is over
+    #ifndef _WIN32
+    Journal journal;
+    unsigned long journal_ticks;
+    JournalCheckpoint checkpoint;   // kept so its buffers are reused
+    #endif
+
+    // The apple draws itself, so the window has to be up first
+    Game(int start_y, int start_x, int set_food_min, int set_food_max, unsigned food_seed):
+        snake(start_x, start_y, '@'), apple('O', set_food_min, set_food_max, food_seed),
+        food_min(set_food_min), food_max(set_food_max), direction(KEY_RIGHT), echo_on(false), caught(false)
+        #ifndef _WIN32
+        , journal_ticks(0)
+        #endif
+        {}
+
+    // Arrow keys and WASD turn; anything else is ignored
+    void key(int input) {
+        switch (input) {
+            case KEY_RIGHT:
+            case 'd':
+                turns.push(KEY_RIGHT, direction);
+                break;
+            case KEY_LEFT:
+            case 'a':
+                turns.push(KEY_LEFT, direction);
+                break;
+            case KEY_UP:
+            case 'w':
+                turns.push(KEY_UP, direction);
+                break;
+            case KEY_DOWN:
+            case 's':
+                turns.push(KEY_DOWN, direction);
+                break;
+        }
+    }
+
+    #ifndef _WIN32
+    // A body that isn't a chain can't be checkpointed; the moves still are
+    void save_checkpoint() {
+        checkpoint.tick = journal_ticks;
+        checkpoint.direction = direction;
+        checkpoint.head_y = snake.get_y();
+        checkpoint.head_x = snake.get_x();
+        checkpoint.food_y = apple.get_y();
+        checkpoint.food_x = apple.get_x();
+        checkpoint.placements = apple.get_placements();
+        if (to_chain(snake.body(), checkpoint.body, snake.get_topology())) journal.save_checkpoint(checkpoint);
+    }
+    #endif
+
+    // Runs the steps a frame is due, stopping if the echo catches the snake
+    void tick(int steps) {
+        for (int step = 0; step < steps && !caught; ++step) {
+            direction = turns.next(direction);
+            recorder.record(direction);
+            std::array<int, 2> back = snake.body().back();
+            if (echo_on) echo.before(snake);
+            game_tick(snake, apple, direction, food_min, food_max);
+            if (echo_on) caught = echo.after(snake);
+            // The tail blanks the cell it leaves, eating or not, which may
+            // hide a ghost
+            ghosts.reveal(back[0], back[1]);
+            ghosts.step();
+            #ifndef _WIN32
+            journal.record(direction);
+            if (journal.is_open() && ++journal_ticks % Journal::CHECKPOINT_TICKS == 0) save_checkpoint();
+            #endif
+        }
+    }
+
+    // Overlays go in just before the refresh and come out after it (and
+    // after publishing); ghosts are drawn as they move, in tick()
+    void draw_overlays(FrameHud& hud, WINDOW* win) {
+        hud.draw(win);
+        if (echo_on) echo.draw();
+    }
+
+    void erase_overlays(FrameHud& hud) {
+        echo.erase();
+        hud.erase();
+    }
+};
+
+#endif // SNAKE_GAME_H
@@ -0,0 +1,84 @@
+#ifndef SNAKE_HISTOGRAM_H
+#define SNAKE_HISTOGRAM_H
+
+#include <array>
+#include <cstdint>
+
+// Fixed-bucket log-linear histogram in the style of HdrHistogram.
+//
+// Values below 2^SUB_BITS get a bucket each; above that every power of two
+// is split into 2^SUB_BITS linear sub-buckets, so the relative error is
+// bounded by 1/2^SUB_BITS (~3%) over the whole 64-bit range. Recording is a
+// couple of shifts and an increment and never allocates.
+class Histogram {
+private:
+    static const int SUB_BITS = 5;
+    static const int SUB_COUNT = 1 << SUB_BITS;
+    static const int BUCKETS = (64 - SUB_BITS + 1) * SUB_COUNT;
+
+    std::array<uint64_t, BUCKETS> counts;
+    uint64_t total;
+    uint64_t min_value;
+    uint64_t max_value;
+
+    static int index_of(uint64_t value) {
+        if (value < (uint64_t)SUB_COUNT) return (int)value;
+        int msb = 63 - __builtin_clzll(value);
+        int shift = msb - SUB_BITS;
+        return (shift + 1) * SUB_COUNT + (int)((value >> shift) - SUB_COUNT);
+    }
+
+    // Highest value that maps to the bucket
+    static uint64_t value_of(int index) {
+        if (index < SUB_COUNT) return (uint64_t)index;
+        int shift = index / SUB_COUNT - 1;
+        uint64_t low = (uint64_t)(SUB_COUNT + index % SUB_COUNT) << shift;
+        return low + ((uint64_t)1 << shift) - 1;
+    }
+
+public:
+    Histogram() { reset(); }
+
+    void reset() {
+        counts.fill(0);
+        total = 0;
+        min_value = UINT64_MAX;
+        max_value = 0;
+    }
+
+    void record(uint64_t value) {
+        counts[index_of(value)]++;
+        total++;
+        if (value < min_value) min_value = value;
+        if (value > max_value) max_value = value;
+    }
+
+    void merge(const Histogram& other) {
+        for (int i = 0; i < BUCKETS; ++i) counts[i] += other.counts[i];
+        total += other.total;
+        if (other.min_value < min_value) min_value = other.min_value;
+        if (other.max_value > max_value) max_value = other.max_value;
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t min() const { return total ? min_value : 0; }
+    uint64_t max() const { return max_value; }
+
+    // p in [0, 100]
+    uint64_t percentile(double p) const {
+        if (total == 0) return 0;
+        uint64_t rank = (uint64_t)(p / 100.0 * total + 0.5);
+        if (rank < 1) rank = 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; ++i) {
+            seen += counts[i];
+            if (seen >= rank) {
+                uint64_t value = value_of(i);
+                return value < max_value ? value : max_value;
+            }
+        }
+        return max_value;
+    }
+};
+
+#endif // SNAKE_HISTOGRAM_H
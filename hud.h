@@ -0,0 +1,127 @@
+#ifndef SNAKE_HUD_H
+#define SNAKE_HUD_H
+
+// Frame-time overlay
+//
+// Records tick time, render time, bytes written per frame, system calls per
+// frame, how late each tick started against its schedule (jitter) and the
+// latency from a key being read to the frame that shows its effect. Samples
+// go into fixed-bucket histograms, so recording never allocates. When
+// visible, the p50/p99/max of each are drawn in the top-right corner.
+//
+// The overlay is drawn for one frame at a time: draw() keeps the cells it
+// covers and erase() puts them back after the refresh. The window always
+// holds only the game, and hiding the overlay leaves nothing behind.
+
+#include "curses.h"
+#include "histogram.h"
+#include "sys_io.h"
+#include <cstdio>
+
+extern TerminalUI ui;
+
+class FrameHud {
+    private:
+        static const int LINES = 8;
+        static const int COLUMNS = 35;
+
+        Histogram tick_ns;
+        Histogram render_ns;
+        Histogram frame_bytes;
+        Histogram input_ns;
+        Histogram frame_syscalls;
+        Histogram jitter_ns;
+        sysio::Snapshot last_syscalls;
+        bool visible;
+        char under[LINES][COLUMNS];     // cells the overlay covers this frame
+        int under_x;
+        int under_width;                // 0 when nothing is covered
+
+        static void format_ns(char* out, size_t size, uint64_t ns) {
+            if (ns < 10000) snprintf(out, size, "%lluns", (unsigned long long)ns);
+            else if (ns < 10000000) snprintf(out, size, "%lluus", (unsigned long long)(ns / 1000));
+            else snprintf(out, size, "%llums", (unsigned long long)(ns / 1000000));
+        }
+
+        void draw_time_line(int y, int x, const char* label, const Histogram& h) {
+            char p50[24], p99[24], max[24];
+            format_ns(p50, sizeof(p50), h.percentile(50));
+            format_ns(p99, sizeof(p99), h.percentile(99));
+            format_ns(max, sizeof(max), h.max());
+            ui.mvprintw(y, x, "%-8s%9s%9s%9s", label, p50, p99, max);
+        }
+
+    public:
+        FrameHud(): last_syscalls{}, visible(false), under_x(0), under_width(0) {}
+
+        void record_tick(uint64_t ns) { tick_ns.record(ns); }
+        void record_render(uint64_t ns) { render_ns.record(ns); }
+        void record_bytes(uint64_t bytes) { frame_bytes.record(bytes); }
+        void record_input(uint64_t ns) { input_ns.record(ns); }
+        void record_jitter(uint64_t ns) { jitter_ns.record(ns); }
+        void record_syscalls(const sysio::Snapshot& frame) {
+            frame_syscalls.record(frame.total());
+            last_syscalls = frame;
+        }
+
+        bool is_visible() const { return visible; }
+
+        // Statistics cover the time since the overlay was last switched on
+        void toggle() {
+            visible = !visible;
+            if (visible) {
+                tick_ns.reset();
+                render_ns.reset();
+                frame_bytes.reset();
+                input_ns.reset();
+                frame_syscalls.reset();
+                jitter_ns.reset();
+            }
+        }
+
+        // Into the current window, over whatever is there; erase() puts it back
+        void draw(WINDOW* win) {
+            if (!visible) return;
+            int height, width;
+            ui.getmaxyx(win, height, width);
+            int x = width > COLUMNS ? width - COLUMNS : 0;
+            if (height < LINES) return;
+
+            under_x = x;
+            under_width = width - x < COLUMNS ? width - x : COLUMNS;
+            for (int y = 0; y < LINES; ++y) {
+                for (int c = 0; c < under_width; ++c) under[y][c] = (char)ui.mvinch(y, x + c);
+            }
+
+            ui.mvprintw(0, x, "%-8s%9s%9s%9s", "", "p50", "p99", "max");
+            draw_time_line(1, x, "tick", tick_ns);
+            draw_time_line(2, x, "render", render_ns);
+            ui.mvprintw(3, x, "%-8s%9llu%9llu%9llu", "bytes",
+                        (unsigned long long)frame_bytes.percentile(50), (unsigned long long)frame_bytes.percentile(99),
+                        (unsigned long long)frame_bytes.max());
+            draw_time_line(4, x, "input", input_ns);
+            ui.mvprintw(5, x, "%-8s%9llu%9llu%9llu", "syscall",
+                        (unsigned long long)frame_syscalls.percentile(50), (unsigned long long)frame_syscalls.percentile(99),
+                        (unsigned long long)frame_syscalls.max());
+            draw_time_line(6, x, "jitter", jitter_ns);
+
+            // Breakdown of the last frame, e.g. "r20 w1 tg20 ts40"
+            char breakdown[COLUMNS + 1];
+            int used = snprintf(breakdown, sizeof(breakdown), "last:");
+            for (int i = 0; i < sysio::CALL_KINDS && used < COLUMNS; ++i) {
+                if (!last_syscalls.calls[i]) continue;
+                used += snprintf(breakdown + used, sizeof(breakdown) - used, " %s%llu",
+                                 sysio::SHORT_NAMES[i], (unsigned long long)last_syscalls.calls[i]);
+            }
+            ui.mvprintw(7, x, "%-*s", COLUMNS, breakdown);
+        }
+
+        void erase() {
+            for (int y = 0; y < LINES; ++y) {
+                for (int c = 0; c < under_width; ++c) ui.mvaddch(y, under_x + c, under[y][c]);
+            }
+            under_width = 0;
+        }
+};
+
+#endif // SNAKE_HUD_H
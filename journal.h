@@ -0,0 +1,287 @@
+#ifndef SNAKE_JOURNAL_H
+#define SNAKE_JOURNAL_H
+
+// Crash-safe session journal (POSIX only)
+//
+// A write-ahead log of the session: a replay header, then records of the
+// directions played, with a checkpoint of the whole game state every
+// CHECKPOINT_TICKS. Each record is
+//
+//   type (1 byte) | payload length (u32) | payload | FNV-1a of the above (u32)
+//
+// so a record torn by a crash fails its checksum and everything from it on
+// is dropped. The game thread only appends to a buffer; a flusher thread
+// writes the buffer out and fdatasync()s it every BATCH_TICKS moves or
+// FLUSH_INTERVAL, whichever comes first, so a crash loses at most that
+// much play and the tick never waits on the disk.
+//
+// Resuming restores the last checkpoint and replays the moves after it.
+// Food placement only depends on the seed and on how many apples were
+// placed, so the checkpoint stores that count rather than the RNG, and the
+// body is stored in chain form (see body_storage.h).
+
+#ifndef _WIN32
+
+#include "replay.h"
+#include "body_storage.h"
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+struct JournalCheckpoint {
+    uint64_t tick;          // moves played before it
+    int direction;
+    int head_y;
+    int head_x;
+    int food_y;
+    int food_x;
+    uint64_t placements;    // apples placed so far, the first one included
+    BodyChain body;
+};
+
+class Journal {
+    private:
+        // Checkpoints from before coordinates were widened to 32 bits are
+        // still read, as CHECKPOINT_16
+        enum Record : uint8_t { HEADER = 'H', MOVES = 'M', CHECKPOINT = 'K', CHECKPOINT_16 = 'C' };
+
+        int fd;
+        std::thread flusher;
+        std::mutex lock;
+        std::condition_variable wake;
+        bool stopping;
+        bool failed;
+        std::vector<uint8_t> pending;       // moves since the last flush
+        std::vector<uint8_t> checkpoint;    // serialised, empty if none is due
+        std::vector<uint8_t> out;           // flusher's scratch
+
+        static uint32_t checksum(const uint8_t* data, size_t size, uint32_t hash = 2166136261u) {
+            for (size_t i = 0; i < size; ++i) hash = (hash ^ data[i]) * 16777619u;
+            return hash;
+        }
+
+        template <typename T>
+        static void put(std::vector<uint8_t>& buffer, T value) {
+            const uint8_t* bytes = (const uint8_t*)&value;
+            buffer.insert(buffer.end(), bytes, bytes + sizeof(value));
+        }
+
+        template <typename T>
+        static bool get(const uint8_t*& data, const uint8_t* end, T& value) {
+            if ((size_t)(end - data) < sizeof(value)) return false;
+            memcpy(&value, data, sizeof(value));
+            data += sizeof(value);
+            return true;
+        }
+
+        static void add_record(std::vector<uint8_t>& buffer, Record type, const uint8_t* payload, size_t size) {
+            size_t start = buffer.size();
+            buffer.push_back(type);
+            put(buffer, (uint32_t)size);
+            buffer.insert(buffer.end(), payload, payload + size);
+            put(buffer, checksum(buffer.data() + start, buffer.size() - start));
+        }
+
+        static void serialise(const JournalCheckpoint& state, std::vector<uint8_t>& buffer) {
+            put(buffer, state.tick);
+            put(buffer, encode_direction(state.direction));
+            put(buffer, (int32_t)state.head_y);
+            put(buffer, (int32_t)state.head_x);
+            put(buffer, (int32_t)state.food_y);
+            put(buffer, (int32_t)state.food_x);
+            put(buffer, state.placements);
+            put(buffer, (int32_t)state.body.front[0]);
+            put(buffer, (int32_t)state.body.front[1]);
+            put(buffer, (uint32_t)state.body.length);
+            for (uint64_t word : state.body.links) put(buffer, word);
+        }
+
+        template <typename Coord>
+        static bool deserialise(const uint8_t* data, const uint8_t* end, JournalCheckpoint& state) {
+            uint8_t direction;
+            Coord head_y, head_x, food_y, food_x, front_y, front_x;
+            uint32_t cells;
+            if (!get(data, end, state.tick) || !get(data, end, direction) ||
+                !get(data, end, head_y) || !get(data, end, head_x) ||
+                !get(data, end, food_y) || !get(data, end, food_x) ||
+                !get(data, end, state.placements) || !get(data, end, front_y) ||
+                !get(data, end, front_x) || !get(data, end, cells)) {
+                return false;
+            }
+            size_t words = cells > 1 ? (cells - 1 + 31) / 32 : 0;
+            if ((size_t)(end - data) != words * sizeof(uint64_t)) return false;
+            state.direction = decode_direction(direction);
+            state.head_y = head_y;
+            state.head_x = head_x;
+            state.food_y = food_y;
+            state.food_x = food_x;
+            state.body.front = {front_y, front_x};
+            state.body.length = cells;
+            state.body.links.resize(words);
+            for (auto& word : state.body.links) get(data, end, word);
+            return true;
+        }
+
+        bool write_all(const uint8_t* data, size_t size) {
+            while (size > 0) {
+                ssize_t written = ::write(fd, data, size);
+                if (written < 0) {
+                    if (errno == EINTR) continue;
+                    return false;
+                }
+                data += written;
+                size -= written;
+            }
+            return true;
+        }
+
+        void run() {
+            std::unique_lock<std::mutex> hold(lock);
+            while (true) {
+                wake.wait_for(hold, FLUSH_INTERVAL, [this] {
+                    return stopping || pending.size() >= BATCH_TICKS || !checkpoint.empty();
+                });
+                if (pending.empty() && checkpoint.empty()) {
+                    if (stopping) return;
+                    continue;
+                }
+                // Moves first: a checkpoint never gets ahead of the moves it covers
+                out.clear();
+                if (!pending.empty()) add_record(out, MOVES, pending.data(), pending.size());
+                if (!checkpoint.empty()) add_record(out, CHECKPOINT, checkpoint.data(), checkpoint.size());
+                pending.clear();
+                checkpoint.clear();
+                hold.unlock();
+                bool ok = write_all(out.data(), out.size()) && fdatasync(fd) == 0;
+                hold.lock();
+                if (!ok) failed = true;
+            }
+        }
+
+    public:
+        // Moves or time between flushes, whichever runs out first
+        static const size_t BATCH_TICKS = 10;
+        static constexpr std::chrono::milliseconds FLUSH_INTERVAL{250};
+        static const uint64_t CHECKPOINT_TICKS = 1000;
+
+        Journal(): fd(-1), stopping(false), failed(false) {
+            pending.reserve(4096);
+            out.reserve(4096);
+        }
+        ~Journal() { close(); }
+        Journal(const Journal&) = delete;
+        Journal& operator=(const Journal&) = delete;
+
+        // Reads back a journal: the header, the last intact checkpoint (if
+        // any) and every move. `valid_size` is where the intact part ends.
+        static bool recover(const char* path, ReplayHeader& header, bool& has_checkpoint,
+                            JournalCheckpoint& state, std::vector<uint8_t>& moves, size_t& valid_size) {
+            std::vector<uint8_t> data;
+            int file = ::open(path, O_RDONLY);
+            if (file < 0) return false;
+            uint8_t chunk[65536];
+            ssize_t got;
+            while ((got = ::read(file, chunk, sizeof(chunk))) > 0) data.insert(data.end(), chunk, chunk + got);
+            ::close(file);
+
+            has_checkpoint = false;
+            moves.clear();
+            valid_size = 0;
+            bool have_header = false;
+            const uint8_t* at = data.data();
+            const uint8_t* end = at + data.size();
+            while (true) {
+                const uint8_t* start = at;
+                uint8_t type;
+                uint32_t size, sum = 0;
+                if (!get(at, end, type) || !get(at, end, size) || (size_t)(end - at) < (size_t)size + 4) break;
+                const uint8_t* payload = at;
+                at += size;
+                get(at, end, sum);
+                if (sum != checksum(start, at - start - 4)) break;
+
+                if (!have_header) {
+                    if (type != HEADER || read_replay_header(payload, size, header) != size) return false;
+                    have_header = true;
+                } else if (type == MOVES) {
+                    moves.insert(moves.end(), payload, payload + size);
+                } else if (type == CHECKPOINT || type == CHECKPOINT_16) {
+                    JournalCheckpoint candidate;
+                    bool read = type == CHECKPOINT ? deserialise<int32_t>(payload, payload + size, candidate)
+                                                   : deserialise<int16_t>(payload, payload + size, candidate);
+                    if (!read || candidate.tick > moves.size()) break;
+                    state = std::move(candidate);
+                    has_checkpoint = true;
+                } else {
+                    break;
+                }
+                valid_size = at - data.data();
+            }
+            return have_header;
+        }
+
+        // Starts a new journal
+        bool create(const char* path, const ReplayHeader& header) {
+            fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0) return false;
+            out.clear();
+            add_record(out, HEADER, (const uint8_t*)&header, sizeof(header));
+            if (!write_all(out.data(), out.size()) || fdatasync(fd) != 0) return false;
+            flusher = std::thread(&Journal::run, this);
+            return true;
+        }
+
+        // Carries on a recovered journal, dropping any torn tail
+        bool append(const char* path, size_t valid_size) {
+            fd = ::open(path, O_WRONLY);
+            if (fd < 0) return false;
+            if (ftruncate(fd, valid_size) != 0 || lseek(fd, 0, SEEK_END) < 0) return false;
+            flusher = std::thread(&Journal::run, this);
+            return true;
+        }
+
+        bool is_open() const { return fd >= 0; }
+
+        // One tick's direction; the only call on the hot path
+        void record(int direction) {
+            if (fd < 0) return;
+            std::lock_guard<std::mutex> hold(lock);
+            pending.push_back(encode_direction(direction));
+            if (pending.size() == BATCH_TICKS) wake.notify_one();
+        }
+
+        // Replaces any checkpoint not yet flushed
+        void save_checkpoint(const JournalCheckpoint& state) {
+            if (fd < 0) return;
+            std::lock_guard<std::mutex> hold(lock);
+            checkpoint.clear();
+            serialise(state, checkpoint);
+            wake.notify_one();
+        }
+
+        // Flushes what is left; false if any write or sync failed
+        bool close() {
+            if (fd < 0) return !failed;
+            {
+                std::lock_guard<std::mutex> hold(lock);
+                stopping = true;
+            }
+            wake.notify_one();
+            if (flusher.joinable()) flusher.join();
+            ::close(fd);
+            fd = -1;
+            return !failed;
+        }
+};
+
+#endif // _WIN32
+
+#endif // SNAKE_JOURNAL_H
@@ -0,0 +1,216 @@
+// Key-to-screen latency probe
+//
+//   g++ -std=c++17 -O2 latency_probe.cpp -o latency_probe -lutil
+//   ./latency_probe [--samples N] [--seed S] [--csv FILE] [-- ./snake args...]
+//
+// Runs the game on a pseudo-terminal, types a turn at a random moment and
+// timestamps the first frame on the output stream whose head has moved the
+// new way. The difference is what a player sees: the poll sleep, waiting for
+// the next tick, the tick itself and the render, end to end. Turns always
+// steer towards the middle of the board so the snake never leaves it.
+
+#include "histogram.h"
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/ioctl.h>
+#if defined(__APPLE__)
+    #include <util.h>
+#else
+    #include <pty.h>
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+static const int ROWS = 24;
+static const int COLUMNS = 80;
+
+// Splits the game's output into frames and finds the head in each
+class FrameReader {
+    private:
+        std::string pending;
+    public:
+        // Appends output; returns true with the head of the newest complete frame
+        bool feed(const char* data, size_t size, int& head_y, int& head_x) {
+            static const char CLEAR[] = "\033[H\033[2J";
+            pending.append(data, size);
+            bool found = false;
+            size_t start;
+            while ((start = pending.find(CLEAR)) != std::string::npos) {
+                size_t body = start + sizeof(CLEAR) - 1;
+                size_t end = body;
+                int rows = 0;
+                while (rows < ROWS && (end = pending.find('\n', end)) != std::string::npos) {
+                    end++;
+                    rows++;
+                }
+                if (rows < ROWS) {
+                    pending.erase(0, start);
+                    return found;
+                }
+
+                int y = 0, x = 0;
+                for (size_t i = body; i < end; ++i) {
+                    char ch = pending[i];
+                    if (ch == '\n') { y++; x = 0; }
+                    else if (ch != '\r') {
+                        if (ch == '@') { head_y = y; head_x = x; found = true; }
+                        x++;
+                    }
+                }
+                pending.erase(0, end);
+            }
+            if (pending.size() > sizeof(CLEAR)) pending.erase(0, pending.size() - sizeof(CLEAR));
+            return found;
+        }
+};
+
+int main(int argc, char** argv) {
+    int samples = 200;
+    unsigned seed = std::random_device{}();
+    const char* csv_path = nullptr;
+    std::vector<char*> game = {(char*)"./snake"};
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) samples = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = (unsigned)atol(argv[++i]);
+        else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) csv_path = argv[++i];
+        else if (strcmp(argv[i], "--") == 0 && i + 1 < argc) {
+            game.assign(argv + i + 1, argv + argc);
+            break;
+        } else {
+            fprintf(stderr, "usage: latency_probe [--samples N] [--seed S] [--csv FILE] [-- GAME ARGS...]\n");
+            return 2;
+        }
+    }
+    game.push_back(nullptr);
+
+    struct winsize size;
+    memset(&size, 0, sizeof(size));
+    size.ws_row = ROWS;
+    size.ws_col = COLUMNS;
+    int terminal;
+    pid_t child = forkpty(&terminal, nullptr, nullptr, &size);
+    if (child < 0) {
+        perror("latency_probe: forkpty");
+        return 1;
+    }
+    if (child == 0) {
+        execvp(game[0], game.data());
+        perror("latency_probe: exec");
+        _exit(127);
+    }
+
+    FrameReader reader;
+    char chunk[65536];
+    int head_y = -1, head_x = -1;
+
+    // Reads whatever output arrives before the deadline; true once the head
+    // has moved by (dy, dx) in sign since the last frame
+    auto wait_for = [&](Clock::time_point deadline, int dy, int dx, Clock::time_point& seen) {
+        while (true) {
+            int timeout = (int)std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+            if (timeout < 0) return false;
+            struct pollfd ready = {terminal, POLLIN, 0};
+            if (poll(&ready, 1, timeout) <= 0) continue;
+            ssize_t got = read(terminal, chunk, sizeof(chunk));
+            auto now = Clock::now();
+            if (got <= 0) return false;
+            int y = head_y, x = head_x;
+            if (!reader.feed(chunk, got, y, x)) continue;
+            bool turned = head_y >= 0 && (dy != 0 ? (y - head_y) * dy > 0 && x == head_x
+                                                  : dx != 0 && (x - head_x) * dx > 0 && y == head_y);
+            head_y = y;
+            head_x = x;
+            if (turned) {
+                seen = now;
+                return true;
+            }
+        }
+    };
+
+    // Let the game come up and draw a few frames
+    Clock::time_point seen;
+    wait_for(Clock::now() + std::chrono::milliseconds(500), 0, 0, seen);
+    if (head_y < 0) {
+        fprintf(stderr, "latency_probe: no frames from %s\n", game[0]);
+        kill(child, SIGTERM);
+        return 1;
+    }
+
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<> pause_ms(150, 400);
+    Histogram latency;
+    std::vector<int64_t> raw;
+    int missed = 0;
+    bool horizontal = true;    // the game starts moving right
+
+    for (int i = 0; i < samples; ++i) {
+        // Idle a random while so keys land at every point of the tick
+        wait_for(Clock::now() + std::chrono::milliseconds(pause_ms(gen)), 0, 0, seen);
+
+        char key;
+        int dy = 0, dx = 0;
+        if (horizontal) {
+            if (head_y < ROWS / 2) { key = 's'; dy = 1; }
+            else { key = 'w'; dy = -1; }
+        } else {
+            if (head_x < COLUMNS / 2) { key = 'd'; dx = 1; }
+            else { key = 'a'; dx = -1; }
+        }
+        auto sent = Clock::now();
+        if (write(terminal, &key, 1) != 1) break;
+
+        if (wait_for(sent + std::chrono::seconds(1), dy, dx, seen)) {
+            int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(seen - sent).count();
+            latency.record(ns);
+            raw.push_back(ns);
+            horizontal = !horizontal;
+        } else {
+            missed++;
+        }
+    }
+
+    kill(child, SIGTERM);
+    auto drain_until = Clock::now() + std::chrono::milliseconds(500);
+    while (Clock::now() < drain_until && waitpid(child, nullptr, WNOHANG) == 0) {
+        struct pollfd ready = {terminal, POLLIN, 0};
+        if (poll(&ready, 1, 10) > 0 && read(terminal, chunk, sizeof(chunk)) <= 0) break;
+    }
+    waitpid(child, nullptr, 0);
+    close(terminal);
+
+    if (latency.count() == 0) {
+        fprintf(stderr, "latency_probe: no turn ever showed up on screen\n");
+        return 1;
+    }
+
+    double mean = 0;
+    for (int64_t ns : raw) mean += ns;
+    mean /= raw.size();
+    printf("key-to-screen latency over %llu turns (%d missed, seed %u)\n",
+           (unsigned long long)latency.count(), missed, seed);
+    printf("%-8s%10s%10s%10s%10s%10s%10s\n", "", "min", "p50", "p90", "p99", "max", "mean");
+    printf("%-8s%10.2f%10.2f%10.2f%10.2f%10.2f%10.2f\n", "ms",
+           latency.min() / 1e6, latency.percentile(50) / 1e6, latency.percentile(90) / 1e6,
+           latency.percentile(99) / 1e6, latency.max() / 1e6, mean / 1e6);
+
+    if (csv_path) {
+        FILE* out = fopen(csv_path, "w");
+        if (!out) {
+            fprintf(stderr, "latency_probe: cannot write %s\n", csv_path);
+            return 1;
+        }
+        fprintf(out, "sample,latency_ns\n");
+        for (size_t i = 0; i < raw.size(); ++i) fprintf(out, "%zu,%lld\n", i, (long long)raw[i]);
+        fclose(out);
+    }
+    return 0;
+}
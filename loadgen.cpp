@@ -0,0 +1,296 @@
+// Synthetic load generator for server-side play
+//
+// Runs many game rooms in one server thread, each driven by a bot player
+// with human-like reaction times and streamed to spectator clients that
+// connect over loopback Unix sockets. The room count is ramped up until a
+// server tick no longer fits the tick deadline, and the highest passing
+// count is reported. Bots and apples are seeded from --seed, so a run
+// plays the same games every time.
+//
+//   g++ -std=c++17 -O2 -pthread loadgen.cpp -o loadgen
+//   ./loadgen [--spectators K] [--rooms N] [--seconds S] [--deadline-ms D] [--max-rooms N] [--seed S]
+
+#include "curses.h"
+#include "snake.h"
+#include "broadcast.h"
+#include "histogram.h"
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <sys/epoll.h>
+
+TerminalUI ui;
+
+using Clock = std::chrono::steady_clock;
+
+static const int BOARD_HEIGHT = 24;
+static const int BOARD_WIDTH = 80;
+static const int MOVE_DELAY = 100;
+
+// A bot player: steers towards the apple, but only re-decides after a
+// human-like reaction delay
+class Bot {
+    private:
+        std::mt19937 gen;
+        std::lognormal_distribution<> reaction_ms;
+        Clock::time_point next_decision;
+    public:
+        Bot(unsigned seed): gen(seed), reaction_ms(5.5, 0.35), next_decision(Clock::now()) {}
+
+        int steer(int direction, Snake& snake, Food& apple, Clock::time_point now) {
+            if (now < next_decision) return direction;
+            next_decision = now + std::chrono::microseconds((long)(reaction_ms(gen) * 1000));
+
+            int dx = apple.get_x() - snake.get_x();
+            int dy = apple.get_y() - snake.get_y();
+            int want;
+            if (std::abs(dx) / 2 >= std::abs(dy)) want = dx >= 0 ? KEY_RIGHT : KEY_LEFT;
+            else want = dy >= 0 ? KEY_DOWN : KEY_UP;
+
+            bool reverse = (want == KEY_LEFT && direction == KEY_RIGHT) || (want == KEY_RIGHT && direction == KEY_LEFT) ||
+                           (want == KEY_UP && direction == KEY_DOWN) || (want == KEY_DOWN && direction == KEY_UP);
+            if (reverse) want = (want == KEY_LEFT || want == KEY_RIGHT) ? (dy >= 0 ? KEY_DOWN : KEY_UP)
+                                                                        : (dx >= 0 ? KEY_RIGHT : KEY_LEFT);
+            return want;
+        }
+};
+
+struct Room {
+    WINDOW* window;
+    Snake snake;
+    Food apple;
+    Bot bot;
+    Broadcaster server;
+    std::string path;
+    int direction;
+
+    // The apple draws itself on construction, so the window is selected first
+    static WINDOW* open_window() {
+        WINDOW* win = ui.newwin(BOARD_HEIGHT, BOARD_WIDTH, 0, 0);
+        ui.use_window(win);
+        return win;
+    }
+
+    Room(int id, unsigned seed):
+        window{open_window()},
+        snake{8, 2, '@'},
+        apple{'O', 10, BOARD_HEIGHT - 10, seed},
+        bot{~seed},
+        direction{KEY_RIGHT} {
+        path = "/tmp/snake-loadgen-" + std::to_string(getpid()) + "-" + std::to_string(id) + ".sock";
+    }
+
+    ~Room() {
+        unlink(path.c_str());
+        ui.delwin(window);
+    }
+};
+
+// Spectator side: one thread reading every client socket
+class Spectators {
+    private:
+        int epoll_fd;
+        std::vector<int> fds;
+        std::atomic<bool> running;
+        std::atomic<unsigned long> received;
+        std::thread reader;
+
+        void run() {
+            std::vector<struct epoll_event> events(1024);
+            char buffer[65536];
+            while (running.load(std::memory_order_relaxed)) {
+                int n = epoll_wait(epoll_fd, events.data(), (int)events.size(), 50);
+                for (int i = 0; i < n; ++i) {
+                    ssize_t got;
+                    while ((got = read(events[i].data.fd, buffer, sizeof(buffer))) > 0) {
+                        received.fetch_add(got, std::memory_order_relaxed);
+                    }
+                }
+            }
+        }
+
+    public:
+        Spectators(): epoll_fd(epoll_create1(0)), running(false), received(0) {}
+
+        ~Spectators() {
+            stop();
+            for (int fd : fds) close(fd);
+            close(epoll_fd);
+        }
+
+        bool connect_to(const std::string& path) {
+            struct sockaddr_un addr;
+            memset(&addr, 0, sizeof(addr));
+            addr.sun_family = AF_UNIX;
+            strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+            int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+            if (fd < 0) return false;
+            if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+                close(fd);
+                return false;
+            }
+            struct epoll_event event;
+            event.events = EPOLLIN;
+            event.data.fd = fd;
+            epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+            fds.push_back(fd);
+            return true;
+        }
+
+        void start() {
+            running = true;
+            reader = std::thread(&Spectators::run, this);
+        }
+
+        void stop() {
+            running = false;
+            if (reader.joinable()) reader.join();
+        }
+
+        size_t count() const { return fds.size(); }
+        unsigned long bytes_received() const { return received.load(); }
+};
+
+struct StepResult {
+    int rooms;
+    size_t spectators;
+    Histogram tick_us;
+    Histogram update_bytes;
+    Histogram drops;            // keyframe skips per tick, all rooms
+    unsigned long dropped;
+    unsigned long received;
+    double seconds;
+    bool passed;
+};
+
+static bool run_step(int rooms, int spectators_per_room, double seconds, int deadline_ms, unsigned seed,
+                     StepResult& result) {
+    std::vector<std::unique_ptr<Room>> world;
+    Spectators spectators;
+    for (int i = 0; i < rooms; ++i) {
+        world.emplace_back(new Room(i, seed + i));
+        if (!world.back()->server.listen_unix(world.back()->path.c_str())) {
+            std::cerr << "loadgen: cannot listen on " << world.back()->path << std::endl;
+            return false;
+        }
+        for (int k = 0; k < spectators_per_room; ++k) {
+            if (!spectators.connect_to(world.back()->path)) {
+                std::cerr << "loadgen: cannot connect spectator (" << strerror(errno) << ")" << std::endl;
+                return false;
+            }
+        }
+    }
+    spectators.start();
+
+    result.rooms = rooms;
+    result.spectators = spectators.count();
+    result.tick_us.reset();
+    result.update_bytes.reset();
+    result.drops.reset();
+    result.dropped = 0;
+
+    auto start = Clock::now();
+    auto next_tick = start;
+    auto end = start + std::chrono::milliseconds((long)(seconds * 1000));
+    while (next_tick < end) {
+        std::this_thread::sleep_until(next_tick);
+        auto tick_start = Clock::now();
+
+        unsigned long drops = 0;
+        for (auto& room : world) {
+            ui.use_window(room->window);
+            room->direction = room->bot.steer(room->direction, room->snake, room->apple, tick_start);
+            game_tick(room->snake, room->apple, room->direction, 10, BOARD_HEIGHT - 10);
+
+            Broadcaster::Stats before = room->server.get_stats();
+            room->server.publish(room->window);
+            const Broadcaster::Stats& after = room->server.get_stats();
+            if (after.frames != before.frames) result.update_bytes.record(after.bytes_encoded - before.bytes_encoded);
+            drops += after.skips - before.skips;
+        }
+
+        auto tick_end = Clock::now();
+        result.tick_us.record(std::chrono::duration_cast<std::chrono::microseconds>(tick_end - tick_start).count());
+        result.drops.record(drops);
+        result.dropped += drops;
+
+        next_tick += std::chrono::milliseconds(MOVE_DELAY);
+        if (next_tick < tick_end) next_tick = tick_end;
+    }
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    spectators.stop();
+    result.received = spectators.bytes_received();
+    ui.use_window(nullptr);
+
+    result.passed = result.tick_us.percentile(99) <= (uint64_t)deadline_ms * 1000;
+    return true;
+}
+
+static void print_step(const StepResult& r) {
+    printf("%7d %10zu %7llu %9.2f %9.2f %9.2f %8llu %8llu %8llu %8llu %8llu %9.1f  %s\n",
+           r.rooms, r.spectators, (unsigned long long)r.tick_us.count(),
+           r.tick_us.percentile(50) / 1000.0, r.tick_us.percentile(99) / 1000.0, r.tick_us.max() / 1000.0,
+           (unsigned long long)r.update_bytes.percentile(50), (unsigned long long)r.update_bytes.percentile(99),
+           (unsigned long long)r.dropped, (unsigned long long)r.drops.percentile(99),
+           (unsigned long long)r.drops.max(),
+           r.received / r.seconds / (1024.0 * 1024.0), r.passed ? "ok" : "MISS");
+}
+
+int main(int argc, char** argv) {
+    int spectators_per_room = 8;
+    int fixed_rooms = 0;
+    int max_rooms = 100000;
+    double seconds = 3.0;
+    int deadline_ms = MOVE_DELAY;
+    unsigned seed = 1234;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--spectators") == 0 && i + 1 < argc) spectators_per_room = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--rooms") == 0 && i + 1 < argc) fixed_rooms = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--max-rooms") == 0 && i + 1 < argc) max_rooms = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) seconds = atof(argv[++i]);
+        else if (strcmp(argv[i], "--deadline-ms") == 0 && i + 1 < argc) deadline_ms = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = (unsigned)strtoul(argv[++i], nullptr, 10);
+        else {
+            std::cerr << "usage: loadgen [--spectators K] [--rooms N] [--max-rooms N] [--seconds S] [--deadline-ms D]"
+                         " [--seed S]" << std::endl;
+            return 2;
+        }
+    }
+
+    printf("%7s %10s %7s %9s %9s %9s %8s %8s %8s %8s %8s %9s\n",
+           "rooms", "spectators", "ticks", "p50 ms", "p99 ms", "max ms", "upd p50", "upd p99",
+           "skips", "skip p99", "skip max", "recv MB/s");
+
+    StepResult result;
+    if (fixed_rooms > 0) {
+        if (!run_step(fixed_rooms, spectators_per_room, seconds, deadline_ms, seed, result)) return 1;
+        print_step(result);
+        return result.passed ? 0 : 1;
+    }
+
+    // Double until the deadline is missed, then bisect
+    int passing = 0;
+    int failing = 0;
+    for (int rooms = 1; rooms <= max_rooms; rooms *= 2) {
+        if (!run_step(rooms, spectators_per_room, seconds, deadline_ms, seed, result)) break;
+        print_step(result);
+        if (!result.passed) {
+            failing = rooms;
+            break;
+        }
+        passing = rooms;
+    }
+    while (failing > 0 && failing - passing > std::max(1, passing / 20)) {
+        int rooms = passing + (failing - passing) / 2;
+        if (!run_step(rooms, spectators_per_room, seconds, deadline_ms, seed, result)) break;
+        print_step(result);
+        if (result.passed) passing = rooms;
+        else failing = rooms;
+    }
+
+    printf("\nhighest room count meeting the %d ms tick deadline: %d (%d spectators each)\n",
+           deadline_ms, passing, spectators_per_room);
+    return passing > 0 ? 0 : 1;
+}
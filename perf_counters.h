@@ -0,0 +1,144 @@
+#ifndef SNAKE_PERF_COUNTERS_H
+#define SNAKE_PERF_COUNTERS_H
+
+// Hardware counters via perf_event_open (Linux only)
+//
+// PerfGroup opens cycles, instructions, cache misses and branch misses as
+// one group so a single read() returns a consistent snapshot of all four.
+// PhaseCounters accumulates the deltas measured around one phase of the
+// loop; PerfPhase does that for a scope. Everything is a no-op when the
+// group couldn't be opened (non-Linux, or perf_event_paranoid too strict).
+
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+
+#ifdef __linux__
+    #include <linux/perf_event.h>
+    #include <sys/syscall.h>
+    #include <sys/ioctl.h>
+    #include <unistd.h>
+#endif
+
+struct PerfSample {
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    uint64_t cache_misses = 0;
+    uint64_t branch_misses = 0;
+};
+
+class PerfGroup {
+    private:
+        static const int EVENTS = 4;
+        int fds[EVENTS];
+        bool ready;
+
+    public:
+        PerfGroup(): ready(false) {
+            for (int& fd : fds) fd = -1;
+        }
+
+        PerfGroup(const PerfGroup&) = delete;
+        PerfGroup& operator=(const PerfGroup&) = delete;
+
+        ~PerfGroup() {
+            #ifdef __linux__
+            for (int fd : fds) {
+                if (fd >= 0) close(fd);
+            }
+            #endif
+        }
+
+        // Counts user-space events of the calling thread
+        bool open() {
+            #ifdef __linux__
+            const uint64_t configs[EVENTS] = {
+                PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES,
+            };
+            for (int i = 0; i < EVENTS; ++i) {
+                struct perf_event_attr attr;
+                memset(&attr, 0, sizeof(attr));
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.size = sizeof(attr);
+                attr.config = configs[i];
+                attr.disabled = i == 0;
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                attr.read_format = PERF_FORMAT_GROUP;
+                fds[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, i == 0 ? -1 : fds[0], 0);
+                if (fds[i] < 0) return false;
+            }
+            ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+            ready = true;
+            #endif
+            return ready;
+        }
+
+        bool is_ready() const { return ready; }
+
+        bool read(PerfSample& sample) {
+            #ifdef __linux__
+            if (!ready) return false;
+            uint64_t values[1 + EVENTS];
+            if (::read(fds[0], values, sizeof(values)) != (ssize_t)sizeof(values) || values[0] != EVENTS) return false;
+            sample.cycles = values[1];
+            sample.instructions = values[2];
+            sample.cache_misses = values[3];
+            sample.branch_misses = values[4];
+            return true;
+            #else
+            (void)sample;
+            return false;
+            #endif
+        }
+};
+
+class PhaseCounters {
+    private:
+        PerfSample total;
+        uint64_t phases = 0;
+    public:
+        void add(const PerfSample& before, const PerfSample& after) {
+            total.cycles += after.cycles - before.cycles;
+            total.instructions += after.instructions - before.instructions;
+            total.cache_misses += after.cache_misses - before.cache_misses;
+            total.branch_misses += after.branch_misses - before.branch_misses;
+            phases++;
+        }
+
+        uint64_t count() const { return phases; }
+        const PerfSample& sum() const { return total; }
+
+        double ipc() const { return total.cycles ? (double)total.instructions / total.cycles : 0; }
+        // Misses per thousand instructions
+        double cache_mpki() const { return total.instructions ? 1000.0 * total.cache_misses / total.instructions : 0; }
+        double branch_mpki() const { return total.instructions ? 1000.0 * total.branch_misses / total.instructions : 0; }
+
+        void print(FILE* out, const char* name) const {
+            if (!phases) return;
+            fprintf(out, "%-8s %10llu phases %14.0f cycles/phase  IPC %5.2f  cache MPKI %7.3f  branch MPKI %7.3f\n",
+                    name, (unsigned long long)phases, (double)total.cycles / phases, ipc(), cache_mpki(), branch_mpki());
+        }
+};
+
+// Measures the enclosing scope into a PhaseCounters; free when group is null
+class PerfPhase {
+    private:
+        PerfGroup* group;
+        PhaseCounters& counters;
+        PerfSample before;
+    public:
+        PerfPhase(PerfGroup* set_group, PhaseCounters& set_counters): group(set_group), counters(set_counters) {
+            if (group && !group->read(before)) group = nullptr;
+        }
+        ~PerfPhase() {
+            PerfSample after;
+            if (group && group->read(after)) counters.add(before, after);
+        }
+        PerfPhase(const PerfPhase&) = delete;
+        PerfPhase& operator=(const PerfPhase&) = delete;
+};
+
+#endif // SNAKE_PERF_COUNTERS_H
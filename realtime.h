@@ -0,0 +1,77 @@
+#ifndef SNAKE_REALTIME_H
+#define SNAKE_REALTIME_H
+
+// Opt-in low-jitter setup for the game thread
+//
+// Pins the calling thread to one core, asks for SCHED_FIFO and locks all
+// memory so that nothing the loop touches is paged out or faulted in later.
+// Each step is best effort: without the privilege for it (CAP_SYS_NICE,
+// CAP_IPC_LOCK or a big enough RLIMIT_MEMLOCK) it reports why and the game
+// carries on without it. Allocate and size every buffer before calling
+// enter(), since mlockall() prefaults whatever is mapped at that point.
+
+#include <string>
+#include <cstring>
+#include <cerrno>
+
+#ifdef __linux__
+    #include <pthread.h>
+    #include <sched.h>
+    #include <sys/mman.h>
+    #include <sys/resource.h>
+#endif
+
+class RealtimeMode {
+    private:
+        std::string report;
+
+        void note(const std::string& line) {
+            if (!report.empty()) report += "; ";
+            report += line;
+        }
+
+        // Touch a chunk of stack now so deeper calls never fault it in
+        static void prefault_stack() {
+            volatile char stack[256 * 1024];
+            for (size_t i = 0; i < sizeof(stack); i += 4096) stack[i] = 0;
+        }
+
+    public:
+        // cpu < 0 leaves affinity alone
+        void enter(int cpu, int priority = 10) {
+            #ifdef __linux__
+            if (cpu >= 0) {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                CPU_SET(cpu, &set);
+                int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+                note(err == 0 ? "pinned to cpu " + std::to_string(cpu) : std::string("pinning failed: ") + strerror(err));
+            }
+
+            struct sched_param param;
+            memset(&param, 0, sizeof(param));
+            param.sched_priority = priority;
+            int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+            if (err == 0) {
+                note("SCHED_FIFO " + std::to_string(priority));
+            } else {
+                // Fall back to the highest normal priority we're allowed
+                bool niced = setpriority(PRIO_PROCESS, 0, -10) == 0;
+                note(std::string("SCHED_FIFO refused (") + strerror(err) + ")" + (niced ? ", nice -10" : ", normal priority"));
+            }
+
+            prefault_stack();
+            if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0) note("memory locked");
+            else note(std::string("mlockall failed: ") + strerror(errno));
+            #else
+            (void)cpu;
+            (void)priority;
+            note("real-time mode is only supported on Linux");
+            #endif
+        }
+
+        // One line describing what was and wasn't granted
+        const std::string& summary() const { return report; }
+};
+
+#endif // SNAKE_REALTIME_H
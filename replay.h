@@ -0,0 +1,370 @@
+#ifndef SNAKE_REPLAY_H
+#define SNAKE_REPLAY_H
+
+// Replay files and ghost runs
+//
+// A replay is a small header (board size, start position, food range, the
+// seed the apple was placed with and whether the edges wrap) followed by
+// one byte per tick holding the
+// direction of that tick. Since food placement only depends on the seed,
+// that is enough to rerun a game exactly. ReplaySim reruns one without
+// touching the screen; GhostPack advances many of them in lockstep with a
+// live game and overlays their bodies on the frame.
+
+#include "curses.h"
+#include "snake.h"
+#include <cstddef>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#ifndef _WIN32
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+struct ReplayHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t food_seed;
+    int32_t height;
+    int32_t width;
+    int32_t start_y;
+    int32_t start_x;
+    int32_t food_min;
+    int32_t food_max;
+    uint32_t flags;     // from version 3
+};
+
+static const char REPLAY_MAGIC[4] = {'S', 'N', 'K', 'R'};
+static const uint32_t REPLAY_VERSION = 3;
+// Version 2 headers end before flags; they are read with flags 0
+static const uint32_t REPLAY_VERSION_NO_FLAGS = 2;
+static const uint32_t REPLAY_WRAP = 1;     // played on a torus
+
+inline ReplayHeader make_replay_header(unsigned food_seed, int height, int width, int start_y, int start_x,
+                                       int food_min, int food_max, uint32_t flags = 0) {
+    ReplayHeader header;
+    memcpy(header.magic, REPLAY_MAGIC, sizeof(header.magic));
+    header.version = REPLAY_VERSION;
+    header.food_seed = food_seed;
+    header.height = height;
+    header.width = width;
+    header.start_y = start_y;
+    header.start_x = start_x;
+    header.food_min = food_min;
+    header.food_max = food_max;
+    header.flags = flags;
+    return header;
+}
+
+// The board a replay was played on
+inline Topology replay_topology(const ReplayHeader& header) {
+    return header.flags & REPLAY_WRAP ? Topology::torus(header.height, header.width) : Topology();
+}
+
+// Directions as stored in a replay
+inline uint8_t encode_direction(int direction) {
+    switch (direction) {
+        case KEY_UP: return 0;
+        case KEY_DOWN: return 1;
+        case KEY_LEFT: return 2;
+        default: return 3;
+    }
+}
+
+inline int decode_direction(uint8_t code) {
+    static const int DIRECTIONS[4] = {KEY_UP, KEY_DOWN, KEY_LEFT, KEY_RIGHT};
+    return DIRECTIONS[code & 3];
+}
+
+// Appends one byte per tick; stdio buffers the writes
+class ReplayWriter {
+    private:
+        FILE* file;
+    public:
+        ReplayWriter(): file(nullptr) {}
+        ~ReplayWriter() { close(); }
+        ReplayWriter(const ReplayWriter&) = delete;
+        ReplayWriter& operator=(const ReplayWriter&) = delete;
+
+        bool open(const char* path, const ReplayHeader& header) {
+            file = fopen(path, "wb");
+            if (!file) return false;
+            return fwrite(&header, sizeof(header), 1, file) == 1;
+        }
+
+        bool is_open() const { return file != nullptr; }
+
+        void record(int direction) {
+            if (file) fputc(encode_direction(direction), file);
+        }
+
+        void close() {
+            if (file) fclose(file);
+            file = nullptr;
+        }
+};
+
+inline bool valid_replay_header(const ReplayHeader& header) {
+    return memcmp(header.magic, REPLAY_MAGIC, sizeof(header.magic)) == 0 &&
+           (header.version == REPLAY_VERSION || header.version == REPLAY_VERSION_NO_FLAGS);
+}
+
+// Parses the header at the start of data, of either version, and brings it
+// up to the current one; returns how many bytes it took, or 0 if there
+// isn't a valid header
+inline size_t read_replay_header(const uint8_t* data, size_t size, ReplayHeader& header) {
+    const size_t OLD_SIZE = offsetof(ReplayHeader, flags);
+    if (size < OLD_SIZE) return 0;
+    memcpy(&header, data, OLD_SIZE);
+    header.flags = 0;
+    if (!valid_replay_header(header)) return 0;
+    size_t used = OLD_SIZE;
+    if (header.version == REPLAY_VERSION) {
+        if (size < sizeof(header)) return 0;
+        memcpy(&header.flags, data + OLD_SIZE, sizeof(header.flags));
+        used = sizeof(header);
+    }
+    header.version = REPLAY_VERSION;
+    return used;
+}
+
+// Reads a whole replay; moves holds the encoded directions
+inline bool load_replay(const char* path, ReplayHeader& header, std::vector<uint8_t>& moves) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+    moves.clear();
+    unsigned char chunk[4096];
+    size_t got;
+    while ((got = fread(chunk, 1, sizeof(chunk), file)) > 0) moves.insert(moves.end(), chunk, chunk + got);
+    fclose(file);
+    size_t header_size = read_replay_header(moves.data(), moves.size(), header);
+    moves.erase(moves.begin(), moves.begin() + header_size);
+    return header_size > 0;
+}
+
+#ifndef _WIN32
+// Regular files named on the command line or directly inside named
+// directories; what can't be read is reported as `program` and skipped
+inline void collect_replays(const char* program, const char* path, std::vector<std::string>& files) {
+    struct stat info;
+    if (stat(path, &info) != 0) {
+        fprintf(stderr, "%s: cannot read %s\n", program, path);
+        return;
+    }
+    if (!S_ISDIR(info.st_mode)) {
+        files.push_back(path);
+        return;
+    }
+    DIR* dir = opendir(path);
+    if (!dir) {
+        fprintf(stderr, "%s: cannot list %s\n", program, path);
+        return;
+    }
+    while (struct dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] == '.') continue;
+        std::string file = std::string(path) + "/" + entry->d_name;
+        if (stat(file.c_str(), &info) == 0 && S_ISREG(info.st_mode)) files.push_back(file);
+    }
+    closedir(dir);
+}
+#endif
+
+// game_tick() without the screen: same moves, same growth, same apples
+class ReplaySim {
+    private:
+        int y;
+        int x;
+        BodyRing tail;
+        Topology topology;
+        std::mt19937 gen;
+        int food_min;
+        int food_max;
+        int food_y;
+        int food_x;
+        unsigned long eaten;
+
+        // Same draws as Food::place()
+        void place_food() {
+            std::uniform_int_distribution<> intDist(food_min, food_max);
+            food_x = intDist(gen);
+            if(food_x % 2 == 1) food_x--;
+            food_y = intDist(gen);
+        }
+
+        void advance(int direction) {
+            switch (direction) {
+                case KEY_UP: y = topology.wrap_y(y - 1); break;
+                case KEY_DOWN: y = topology.wrap_y(y + 1); break;
+                case KEY_RIGHT: x = topology.wrap_x(x + 2); break;
+                case KEY_LEFT: x = topology.wrap_x(x - 2); break;
+            }
+        }
+    public:
+        explicit ReplaySim(const ReplayHeader& header):
+            y(header.start_y), x(header.start_x), topology(replay_topology(header)), gen(header.food_seed),
+            food_min(header.food_min), food_max(header.food_max), eaten(0) {
+            // Same starting body as Tail
+            tail.push_back({y, x - 2});
+            tail.push_back({y, x - 4});
+            tail.push_back({y, x - 6});
+            place_food();
+        }
+
+        void step(int direction) {
+            if (y == food_y && x == food_x) {
+                tail.push_front({y, x});
+                advance(direction);
+                place_food();
+                eaten++;
+            }
+            tail.pop_back();
+            tail.push_front({y, x});
+            advance(direction);
+        }
+
+        int get_y() const { return y; }
+        int get_x() const { return x; }
+        int get_food_y() const { return food_y; }
+        int get_food_x() const { return food_x; }
+        unsigned long get_eaten() const { return eaten; }
+        size_t get_length() const { return tail.size() + 1; }
+        const BodyRing& body() const { return tail; }
+        const Topology& get_topology() const { return topology; }
+};
+
+// Earlier runs raced alongside the live game. All ghosts step together, one
+// tick at a time. Like the live snake, a ghost is drawn as it moves: each
+// step puts down its new head and takes up its old tail, so a frame costs a
+// few cells per ghost however long the ghosts are. Ghosts only draw into
+// blank cells (or their own), so the live game is always on top, and a
+// count per cell keeps a cell that two ghosts share until both have left.
+class GhostPack {
+    private:
+        struct Ghost {
+            ReplaySim sim;
+            std::vector<uint8_t> moves;
+            size_t next;
+            bool shown;     // on the board; it leaves the tick after its last move
+        };
+
+        std::vector<Ghost> ghosts;
+        std::vector<uint16_t> cover;    // ghost cells on each board cell
+        int height;
+        int width;
+        char head;
+        char body;
+
+        bool inside(int cell_y, int cell_x) const {
+            return cell_y >= 0 && cell_y < height && cell_x >= 0 && cell_x < width;
+        }
+
+        // Draws over blanks and ghosts, never over the game
+        void put(int cell_y, int cell_x, char ch) {
+            int shown = ui.mvinch(cell_y, cell_x);
+            if (shown == ' ' || shown == head || shown == body) ui.mvaddch(cell_y, cell_x, ch);
+        }
+
+        void enter(int cell_y, int cell_x, char ch) {
+            if (!inside(cell_y, cell_x)) return;
+            cover[(size_t)cell_y * width + cell_x]++;
+            put(cell_y, cell_x, ch);
+        }
+
+        void leave(int cell_y, int cell_x) {
+            if (!inside(cell_y, cell_x) || --cover[(size_t)cell_y * width + cell_x] > 0) return;
+            int shown = ui.mvinch(cell_y, cell_x);
+            if (shown == head || shown == body) ui.mvaddch(cell_y, cell_x, ' ');
+        }
+
+        template <typename F>
+        static void each_cell(const Ghost& ghost, F&& f) {
+            f(ghost.sim.get_y(), ghost.sim.get_x());
+            const BodyRing& cells = ghost.sim.body();
+            for (size_t i = 0; i < cells.size(); ++i) f(cells.at(i)[0], cells.at(i)[1]);
+        }
+
+        void show(const Ghost& ghost) {
+            enter(ghost.sim.get_y(), ghost.sim.get_x(), head);
+            const BodyRing& cells = ghost.sim.body();
+            for (size_t i = 0; i < cells.size(); ++i) enter(cells.at(i)[0], cells.at(i)[1], body);
+        }
+
+        void hide(const Ghost& ghost) {
+            each_cell(ghost, [this](int cell_y, int cell_x) { leave(cell_y, cell_x); });
+        }
+    public:
+        GhostPack(char set_head = '&', char set_body = '.'): height(0), width(0), head(set_head), body(set_body) {}
+
+        // Draws the ghost where it starts; the window has to be up
+        void add(const ReplayHeader& header, std::vector<uint8_t> moves) {
+            if (header.height > height || header.width > width) {
+                // A bigger board than any so far: count the cells again
+                for (const auto& ghost : ghosts) {
+                    if (ghost.shown) hide(ghost);
+                }
+                height = std::max(height, (int)header.height);
+                width = std::max(width, (int)header.width);
+                cover.assign((size_t)height * width, 0);
+                for (const auto& ghost : ghosts) {
+                    if (ghost.shown) show(ghost);
+                }
+            }
+            ghosts.push_back({ReplaySim(header), std::move(moves), 0, false});
+            Ghost& ghost = ghosts.back();
+            ghost.shown = !ghost.moves.empty();
+            if (ghost.shown) show(ghost);
+        }
+
+        bool load(const char* path) {
+            ReplayHeader header;
+            std::vector<uint8_t> moves;
+            if (!load_replay(path, header, moves)) return false;
+            add(header, std::move(moves));
+            return true;
+        }
+
+        size_t size() const { return ghosts.size(); }
+
+        // A ghost whose replay has run out stays for one more tick, as it
+        // ended, then is taken off the board
+        void step() {
+            for (auto& ghost : ghosts) {
+                if (!ghost.shown) continue;
+                if (ghost.next == ghost.moves.size()) {
+                    hide(ghost);
+                    ghost.shown = false;
+                    continue;
+                }
+                std::array<int, 2> back = ghost.sim.body().back();
+                size_t length = ghost.sim.get_length();
+                ghost.sim.step(decode_direction(ghost.moves[ghost.next++]));
+                // The tail moves on every tick; eating also passes through
+                // one more cell on the way
+                leave(back[0], back[1]);
+                bool grew = ghost.sim.get_length() > length;
+                if (grew) enter(ghost.sim.body().at(0)[0], ghost.sim.body().at(0)[1], body);
+                const auto& old_head = ghost.sim.body().at(grew ? 1 : 0);
+                if (inside(old_head[0], old_head[1])) put(old_head[0], old_head[1], body);
+                enter(ghost.sim.get_y(), ghost.sim.get_x(), head);
+            }
+        }
+
+        // The live game blanked a cell (its tail moved on); any ghost there
+        // shows again
+        void reveal(int cell_y, int cell_x) {
+            if (inside(cell_y, cell_x) && cover[(size_t)cell_y * width + cell_x] > 0) put(cell_y, cell_x, body);
+        }
+
+        // Takes every ghost off the board
+        void clear() {
+            for (const auto& ghost : ghosts) {
+                if (ghost.shown) hide(ghost);
+            }
+            ghosts.clear();
+        }
+};
+
+#endif // SNAKE_REPLAY_H
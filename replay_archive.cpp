@@ -0,0 +1,108 @@
+// Replay archive tool
+//
+//   g++ -std=c++17 -O2 replay_archive.cpp -o replay_archive
+//   ./replay_archive pack ARCHIVE DIR|FILE...
+//   ./replay_archive extract ARCHIVE INDEX FILE
+//   ./replay_archive verify ARCHIVE DIR|FILE...
+//
+// pack trains the shared model on the given replays and writes them all
+// to ARCHIVE in sorted path order; extract writes replay INDEX back out as
+// a normal replay file; verify checks every replay decodes to the original.
+
+#include "curses.h"
+#include "replay_archive.h"
+#include <algorithm>
+
+// Replays never draw, but snake.h expects the program to own a terminal
+TerminalUI ui;
+
+static bool load_all(char** paths, int count, std::vector<ReplayHeader>& headers,
+                     std::vector<std::vector<uint8_t>>& corpus, uint64_t& bytes) {
+    std::vector<std::string> files;
+    for (int i = 0; i < count; ++i) collect_replays("replay_archive", paths[i], files);
+    std::sort(files.begin(), files.end());
+    bytes = 0;
+    for (const auto& file : files) {
+        ReplayHeader header;
+        std::vector<uint8_t> moves;
+        if (!load_replay(file.c_str(), header, moves)) {
+            fprintf(stderr, "replay_archive: %s is not a replay\n", file.c_str());
+            return false;
+        }
+        bytes += sizeof(header) + moves.size();
+        headers.push_back(header);
+        corpus.push_back(std::move(moves));
+    }
+    return !files.empty();
+}
+
+static int usage() {
+    fprintf(stderr, "usage: replay_archive pack ARCHIVE DIR|FILE...\n"
+                    "       replay_archive extract ARCHIVE INDEX FILE\n"
+                    "       replay_archive verify ARCHIVE DIR|FILE...\n");
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 4) return usage();
+    std::string command = argv[1];
+    const char* path = argv[2];
+
+    if (command == "pack") {
+        std::vector<ReplayHeader> headers;
+        std::vector<std::vector<uint8_t>> corpus;
+        uint64_t bytes;
+        if (!load_all(argv + 3, argc - 3, headers, corpus, bytes)) return 1;
+        if (!archive::write_archive(path, headers, corpus)) {
+            fprintf(stderr, "replay_archive: cannot write %s\n", path);
+            return 1;
+        }
+        size_t packed = archive::file_size(path);
+        printf("%zu replays, %llu bytes -> %zu bytes (%.1fx, %.1f bytes per replay)\n", corpus.size(),
+               (unsigned long long)bytes, packed, (double)bytes / packed, (double)packed / corpus.size());
+        return 0;
+    }
+
+    archive::Reader reader;
+    if (!reader.open(path)) {
+        fprintf(stderr, "replay_archive: %s is not a replay archive\n", path);
+        return 1;
+    }
+    ReplayHeader header;
+    std::vector<uint8_t> moves;
+
+    if (command == "extract" && argc == 5) {
+        size_t index = strtoul(argv[3], nullptr, 10);
+        if (!reader.read(index, header, moves)) {
+            fprintf(stderr, "replay_archive: no replay %zu in %s\n", index, path);
+            return 1;
+        }
+        ReplayWriter writer;
+        if (!writer.open(argv[4], header)) {
+            fprintf(stderr, "replay_archive: cannot write %s\n", argv[4]);
+            return 1;
+        }
+        for (uint8_t move : moves) writer.record(decode_direction(move));
+        return 0;
+    }
+
+    if (command == "verify") {
+        std::vector<ReplayHeader> headers;
+        std::vector<std::vector<uint8_t>> corpus;
+        uint64_t bytes;
+        if (!load_all(argv + 3, argc - 3, headers, corpus, bytes)) return 1;
+        if (corpus.size() != reader.size()) {
+            fprintf(stderr, "replay_archive: %zu replays given, %zu archived\n", corpus.size(), reader.size());
+            return 1;
+        }
+        for (size_t i = 0; i < corpus.size(); ++i) {
+            if (!reader.read(i, header, moves) || moves != corpus[i] || memcmp(&header, &headers[i], sizeof(header)) != 0) {
+                fprintf(stderr, "replay_archive: replay %zu differs\n", i);
+                return 1;
+            }
+        }
+        printf("%zu replays match\n", corpus.size());
+        return 0;
+    }
+    return usage();
+}
@@ -0,0 +1,377 @@
+#ifndef SNAKE_REPLAY_ARCHIVE_H
+#define SNAKE_REPLAY_ARCHIVE_H
+
+// Replay archives (POSIX only)
+//
+// Many replays in one file, each compressed on its own but against a model
+// trained on all of them. Player input is mostly "keep going", and turns
+// mostly head for the apple, so while coding a replay is rerun on
+// ReplaySim and each direction is predicted from the last two, how long
+// the snake has been going straight and which way the apple lies. A static
+// range coder then spends a fraction of a bit on an expected move. The model is
+// stored once in the archive; an offset table gives random access to any
+// replay without decoding the others.
+//
+// Layout: magic, version, the model's frequency table, the replay count,
+// one offset per replay (plus the end), then the entries. An entry is the
+// replay header as varints followed by the tick count and the coded moves.
+// Version 1 entries have no header flags; they are read as an open board.
+
+#ifndef _WIN32
+
+#include "replay.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace archive {
+
+static const char MAGIC[4] = {'S', 'N', 'K', 'A'};
+static const uint32_t VERSION = 2;
+static const uint32_t VERSION_NO_FLAGS = 1;
+
+// Context: the last two directions, a bucket of the current run length and
+// the side the apple is on, vertically and horizontally
+static const int RUN_BUCKETS = 6;
+static const int CONTEXTS = 16 * RUN_BUCKETS * 3 * 3;
+static const int FREQ_BITS = 12;
+static const uint32_t FREQ_TOTAL = 1u << FREQ_BITS;
+
+class History {
+    private:
+        uint32_t last2;
+        uint32_t run;
+
+        // The way to the apple is the short way, over an edge on a torus
+        static int side(int delta) { return delta > 0 ? 2 : delta < 0 ? 0 : 1; }
+    public:
+        History(): last2(0xf), run(0) {}    // as if moving right, which games start with
+
+        int context(const ReplaySim& sim) const {
+            int bucket = run == 0 ? 0 : run < 2 ? 1 : run < 4 ? 2 : run < 8 ? 3 : run < 16 ? 4 : 5;
+            const Topology& topology = sim.get_topology();
+            int apple = side(topology.delta_y(sim.get_y(), sim.get_food_y())) * 3 +
+                        side(topology.delta_x(sim.get_x(), sim.get_food_x()));
+            return ((int)last2 * RUN_BUCKETS + bucket) * 9 + apple;
+        }
+
+        void push(uint8_t move) {
+            run = move == (last2 & 3) ? run + 1 : 0;
+            last2 = ((last2 << 2) | move) & 0xf;
+        }
+};
+
+class Model {
+    private:
+        uint16_t freq[CONTEXTS][4];
+        uint16_t cum[CONTEXTS][5];
+
+        void build_cumulative() {
+            for (int c = 0; c < CONTEXTS; ++c) {
+                cum[c][0] = 0;
+                for (int s = 0; s < 4; ++s) cum[c][s + 1] = cum[c][s] + freq[c][s];
+            }
+        }
+
+    public:
+        // Scale corpus counts to FREQ_TOTAL per context, every move possible
+        void train(const std::vector<ReplayHeader>& headers, const std::vector<std::vector<uint8_t>>& corpus) {
+            std::vector<uint64_t> counts(CONTEXTS * 4, 0);
+            for (size_t i = 0; i < corpus.size(); ++i) {
+                ReplaySim sim(headers[i]);
+                History history;
+                for (uint8_t move : corpus[i]) {
+                    counts[history.context(sim) * 4 + (move & 3)]++;
+                    history.push(move & 3);
+                    sim.step(decode_direction(move));
+                }
+            }
+            for (int c = 0; c < CONTEXTS; ++c) {
+                uint64_t total = 0;
+                for (int s = 0; s < 4; ++s) total += counts[c * 4 + s];
+                uint32_t sum = 0;
+                int largest = 0;
+                for (int s = 0; s < 4; ++s) {
+                    uint64_t scaled = total ? counts[c * 4 + s] * (FREQ_TOTAL - 4) / total : (FREQ_TOTAL - 4) / 4;
+                    freq[c][s] = (uint16_t)(1 + scaled);
+                    sum += freq[c][s];
+                    if (freq[c][s] > freq[c][largest]) largest = s;
+                }
+                freq[c][largest] += FREQ_TOTAL - sum;
+            }
+            build_cumulative();
+        }
+
+        void write(std::vector<uint8_t>& out) const {
+            const uint8_t* bytes = (const uint8_t*)freq;
+            out.insert(out.end(), bytes, bytes + sizeof(freq));
+        }
+
+        size_t read(const uint8_t* data, size_t size) {
+            if (size < sizeof(freq)) return 0;
+            memcpy(freq, data, sizeof(freq));
+            for (int c = 0; c < CONTEXTS; ++c) {
+                uint32_t sum = 0;
+                for (int s = 0; s < 4; ++s) sum += freq[c][s];
+                if (sum != FREQ_TOTAL) return 0;
+            }
+            build_cumulative();
+            return sizeof(freq);
+        }
+
+        uint32_t low(int context, int move) const { return cum[context][move]; }
+        uint32_t size(int context, int move) const { return freq[context][move]; }
+
+        int find(int context, uint32_t target) const {
+            int move = 0;
+            while (cum[context][move + 1] <= target) move++;
+            return move;
+        }
+};
+
+// Carry-less range coder (Subbotin)
+static const uint32_t TOP = 1u << 24;
+static const uint32_t BOTTOM = 1u << 16;
+
+class RangeEncoder {
+    private:
+        uint32_t low;
+        uint32_t range;
+        std::vector<uint8_t>& out;
+    public:
+        explicit RangeEncoder(std::vector<uint8_t>& set_out): low(0), range(0xffffffffu), out(set_out) {}
+
+        void encode(uint32_t cum_freq, uint32_t freq) {
+            range >>= FREQ_BITS;
+            low += cum_freq * range;
+            range *= freq;
+            while ((low ^ (low + range)) < TOP || (range < BOTTOM && ((range = -low & (BOTTOM - 1)), true))) {
+                out.push_back((uint8_t)(low >> 24));
+                low <<= 8;
+                range <<= 8;
+            }
+        }
+
+        void finish() {
+            for (int i = 0; i < 4; ++i) {
+                out.push_back((uint8_t)(low >> 24));
+                low <<= 8;
+            }
+        }
+};
+
+class RangeDecoder {
+    private:
+        uint32_t low;
+        uint32_t range;
+        uint32_t code;
+        const uint8_t* in;
+        const uint8_t* end;
+
+        uint8_t next() { return in < end ? *in++ : 0; }
+    public:
+        RangeDecoder(const uint8_t* data, const uint8_t* set_end): low(0), range(0xffffffffu), code(0), in(data), end(set_end) {
+            for (int i = 0; i < 4; ++i) code = (code << 8) | next();
+        }
+
+        uint32_t target() {
+            range >>= FREQ_BITS;
+            uint32_t value = (code - low) / range;
+            return value < FREQ_TOTAL ? value : FREQ_TOTAL - 1;
+        }
+
+        void consume(uint32_t cum_freq, uint32_t freq) {
+            low += cum_freq * range;
+            range *= freq;
+            while ((low ^ (low + range)) < TOP || (range < BOTTOM && ((range = -low & (BOTTOM - 1)), true))) {
+                code = (code << 8) | next();
+                low <<= 8;
+                range <<= 8;
+            }
+        }
+};
+
+inline size_t file_size(const char* path) {
+    struct stat info;
+    return stat(path, &info) == 0 ? (size_t)info.st_size : 0;
+}
+
+inline void put_varint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+inline bool get_varint(const uint8_t*& in, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; in < end && shift < 64; shift += 7) {
+        uint8_t byte = *in++;
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+inline uint64_t zigzag(int64_t value) { return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63); }
+inline int64_t unzigzag(uint64_t value) { return (int64_t)(value >> 1) ^ -(int64_t)(value & 1); }
+
+inline void encode_entry(const Model& model, const ReplayHeader& header, const std::vector<uint8_t>& moves,
+                         std::vector<uint8_t>& out) {
+    put_varint(out, header.food_seed);
+    const int32_t fields[] = {header.height, header.width, header.start_y, header.start_x, header.food_min, header.food_max};
+    for (int32_t field : fields) put_varint(out, zigzag(field));
+    put_varint(out, header.flags);
+    put_varint(out, moves.size());
+
+    RangeEncoder encoder(out);
+    ReplaySim sim(header);
+    History history;
+    for (uint8_t move : moves) {
+        int context = history.context(sim);
+        encoder.encode(model.low(context, move & 3), model.size(context, move & 3));
+        history.push(move & 3);
+        sim.step(decode_direction(move));
+    }
+    encoder.finish();
+}
+
+inline bool decode_entry(const Model& model, const uint8_t* in, const uint8_t* end, uint32_t version,
+                         ReplayHeader& header, std::vector<uint8_t>& moves) {
+    uint64_t seed, count, flags = 0;
+    uint64_t fields[6];
+    if (!get_varint(in, end, seed)) return false;
+    for (auto& field : fields) {
+        if (!get_varint(in, end, field)) return false;
+    }
+    if (version != VERSION_NO_FLAGS && !get_varint(in, end, flags)) return false;
+    if (!get_varint(in, end, count)) return false;
+    header = make_replay_header((unsigned)seed, (int)unzigzag(fields[0]), (int)unzigzag(fields[1]),
+                                (int)unzigzag(fields[2]), (int)unzigzag(fields[3]),
+                                (int)unzigzag(fields[4]), (int)unzigzag(fields[5]), (uint32_t)flags);
+
+    moves.resize(count);
+    RangeDecoder decoder(in, end);
+    ReplaySim sim(header);
+    History history;
+    for (uint64_t i = 0; i < count; ++i) {
+        int context = history.context(sim);
+        int move = model.find(context, decoder.target());
+        decoder.consume(model.low(context, move), model.size(context, move));
+        moves[i] = (uint8_t)move;
+        history.push((uint8_t)move);
+        sim.step(decode_direction((uint8_t)move));
+    }
+    return true;
+}
+
+// Trains on every replay given and writes them all to one archive
+inline bool write_archive(const char* path, const std::vector<ReplayHeader>& headers,
+                          const std::vector<std::vector<uint8_t>>& corpus) {
+    Model model;
+    model.train(headers, corpus);
+
+    std::vector<uint8_t> out(MAGIC, MAGIC + sizeof(MAGIC));
+    out.insert(out.end(), (const uint8_t*)&VERSION, (const uint8_t*)&VERSION + sizeof(VERSION));
+    model.write(out);
+    uint32_t count = (uint32_t)corpus.size();
+    out.insert(out.end(), (const uint8_t*)&count, (const uint8_t*)&count + sizeof(count));
+
+    std::vector<uint8_t> entries;
+    std::vector<uint64_t> offsets;
+    for (size_t i = 0; i < corpus.size(); ++i) {
+        offsets.push_back(entries.size());
+        encode_entry(model, headers[i], corpus[i], entries);
+    }
+    offsets.push_back(entries.size());
+    out.insert(out.end(), (const uint8_t*)offsets.data(), (const uint8_t*)(offsets.data() + offsets.size()));
+    out.insert(out.end(), entries.begin(), entries.end());
+
+    FILE* file = fopen(path, "wb");
+    if (!file) return false;
+    bool ok = fwrite(out.data(), 1, out.size(), file) == out.size();
+    return fclose(file) == 0 && ok;
+}
+
+// A mapped archive; read(i) decodes replay i alone
+class Reader {
+    private:
+        void* mapped;
+        size_t mapped_size;
+        Model model;
+        uint32_t version;
+        uint32_t count;
+        const uint8_t* offsets;
+        const uint8_t* entries;
+
+        // The table isn't necessarily 8-byte aligned in the mapping
+        uint64_t offset(size_t index) const {
+            uint64_t value;
+            memcpy(&value, offsets + index * sizeof(value), sizeof(value));
+            return value;
+        }
+
+    public:
+        Reader(): mapped(nullptr), mapped_size(0), version(0), count(0), offsets(nullptr), entries(nullptr) {}
+        ~Reader() {
+            if (mapped) munmap(mapped, mapped_size);
+        }
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        bool open(const char* path) {
+            int fd = ::open(path, O_RDONLY);
+            if (fd < 0) return false;
+            struct stat info;
+            if (fstat(fd, &info) != 0 || info.st_size == 0) {
+                ::close(fd);
+                return false;
+            }
+            mapped_size = info.st_size;
+            mapped = mmap(nullptr, mapped_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (mapped == MAP_FAILED) {
+                mapped = nullptr;
+                return false;
+            }
+
+            const uint8_t* data = (const uint8_t*)mapped;
+            const uint8_t* end = data + mapped_size;
+            if (mapped_size < sizeof(MAGIC) + sizeof(version) || memcmp(data, MAGIC, sizeof(MAGIC)) != 0) return false;
+            memcpy(&version, data + sizeof(MAGIC), sizeof(version));
+            if (version != VERSION && version != VERSION_NO_FLAGS) return false;
+            data += sizeof(MAGIC) + sizeof(version);
+            size_t used = model.read(data, end - data);
+            if (!used) return false;
+            data += used;
+            if ((size_t)(end - data) < sizeof(count)) return false;
+            memcpy(&count, data, sizeof(count));
+            data += sizeof(count);
+            if ((size_t)(end - data) / sizeof(uint64_t) < (size_t)count + 1) return false;
+            offsets = data;
+            entries = data + ((size_t)count + 1) * sizeof(uint64_t);
+            return offset(count) <= (size_t)(end - entries);
+        }
+
+        size_t size() const { return count; }
+
+        bool read(size_t index, ReplayHeader& header, std::vector<uint8_t>& moves) const {
+            if (index >= count) return false;
+            uint64_t start = offset(index), stop = offset(index + 1);
+            if (start > stop || stop > offset(count)) return false;
+            return decode_entry(model, entries + start, entries + stop, version, header, moves);
+        }
+};
+
+} // namespace archive
+
+#endif // _WIN32
+
+#endif // SNAKE_REPLAY_ARCHIVE_H
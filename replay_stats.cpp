@@ -0,0 +1,290 @@
+// Replay corpus analyzer
+//
+//   g++ -std=c++17 -O2 -pthread replay_stats.cpp -o replay_stats
+//   ./replay_stats [--threads N] [--csv FILE] [--telemetry DIR] DIR|FILE...
+//
+// Memory-maps every replay in the given directories and fast-forwards them
+// on the headless engine, one file at a time per worker thread. The game
+// itself never ends, so a replay is cut at the first tick that would have
+// been fatal with walls and self-collision, and that is its death cause;
+// otherwise it ran until the player quit. Reports throughput, the score
+// distribution, the mean score over time and a heatmap of head positions.
+// --csv writes the score curve; --telemetry appends one row per game to a
+// columnar table (see telemetry.h) for telemetry_query.
+
+#include "curses.h"
+#include "replay.h"
+#include "board.h"
+#include "histogram.h"
+#include "telemetry.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// ReplaySim draws nothing, but snake.h expects the program to own a terminal
+TerminalUI ui;
+
+enum Death { QUIT, WALL, SELF, DEATHS };
+static const char* const DEATH_NAMES[DEATHS] = {"quit", "wall", "self"};
+
+// Score curve resolution and extent
+static const int CURVE_STEP = 100;
+static const int CURVE_POINTS = 1000;
+
+// Heatmap extent; heads beyond it are only counted in the wall deaths
+static const int MAP_ROWS = 128;
+static const int MAP_COLUMNS = 512;
+
+// One game's outcome, as stored in the telemetry table
+struct GameResult {
+    int64_t ticks;
+    int64_t score;
+    int64_t length;
+    int64_t death;
+};
+
+struct CorpusStats {
+    uint64_t games = 0;
+    uint64_t skipped = 0;
+    uint64_t ticks = 0;
+    uint64_t bytes = 0;
+    uint64_t deaths[DEATHS] = {};
+    Histogram scores;
+    Histogram lengths;
+    std::vector<uint64_t> curve_sum = std::vector<uint64_t>(CURVE_POINTS);
+    std::vector<uint64_t> curve_games = std::vector<uint64_t>(CURVE_POINTS);
+    std::vector<uint64_t> heat = std::vector<uint64_t>((size_t)MAP_ROWS * MAP_COLUMNS);
+
+    void merge(const CorpusStats& other) {
+        games += other.games;
+        skipped += other.skipped;
+        ticks += other.ticks;
+        bytes += other.bytes;
+        for (int i = 0; i < DEATHS; ++i) deaths[i] += other.deaths[i];
+        scores.merge(other.scores);
+        lengths.merge(other.lengths);
+        for (int i = 0; i < CURVE_POINTS; ++i) {
+            curve_sum[i] += other.curve_sum[i];
+            curve_games[i] += other.curve_games[i];
+        }
+        for (size_t i = 0; i < heat.size(); ++i) heat[i] += other.heat[i];
+    }
+};
+
+template <bool Wrap, typename Board>
+static GameResult analyze(const Board& board, const ReplayHeader& header, const uint8_t* moves, size_t count,
+                          CorpusStats& stats, BoardScratch& scratch) {
+    BoardSim<Board, Wrap> sim(board, header, scratch);
+
+    Death death = QUIT;
+    size_t tick = 0;
+    for (; tick < count; ++tick) {
+        if (tick % CURVE_STEP == 0 && tick / CURVE_STEP < CURVE_POINTS) {
+            stats.curve_sum[tick / CURVE_STEP] += sim.get_eaten();
+            stats.curve_games[tick / CURVE_STEP]++;
+        }
+
+        StepOutcome outcome = sim.step(decode_direction(moves[tick]));
+        if (outcome == OFF_BOARD) {
+            death = WALL;
+            break;
+        }
+        int y = sim.get_y(), x = sim.get_x();
+        if (y < MAP_ROWS && x < MAP_COLUMNS) stats.heat[(size_t)y * MAP_COLUMNS + x]++;
+        if (outcome == INTO_BODY) {
+            death = SELF;
+            break;
+        }
+    }
+
+    GameResult result = {(int64_t)(tick < count ? tick + 1 : count), (int64_t)sim.get_eaten(),
+                         (int64_t)sim.get_length(), death};
+    stats.games++;
+    stats.ticks += result.ticks;
+    stats.deaths[death]++;
+    stats.scores.record(result.score);
+    stats.lengths.record(result.length);
+    return result;
+}
+
+// scratch is the worker's occupancy storage, reused across files
+static bool analyze_file(const std::string& path, CorpusStats& stats, BoardScratch& scratch,
+                         GameResult& result) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < offsetof(ReplayHeader, flags)) {
+        close(fd);
+        return false;
+    }
+    size_t size = info.st_size;
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) return false;
+    madvise(mapped, size, MADV_SEQUENTIAL);
+
+    ReplayHeader header;
+    size_t header_size = read_replay_header((const uint8_t*)mapped, size, header);
+    bool ok = header_size > 0 && header.height > 0 && header.width > 0;
+    if (ok) {
+        const uint8_t* moves = (const uint8_t*)mapped + header_size;
+        result = with_board(header.height, header.width, [&](auto board) {
+            if (header.flags & REPLAY_WRAP) return analyze<true>(board, header, moves, size - header_size, stats, scratch);
+            return analyze<false>(board, header, moves, size - header_size, stats, scratch);
+        });
+        stats.bytes += size;
+    }
+    munmap(mapped, size);
+    return ok;
+}
+
+static void print_heatmap(const CorpusStats& stats) {
+    int top = MAP_ROWS, bottom = -1, left = MAP_COLUMNS, right = -1;
+    uint64_t peak = 0;
+    for (int y = 0; y < MAP_ROWS; ++y) {
+        for (int x = 0; x < MAP_COLUMNS; ++x) {
+            uint64_t visits = stats.heat[(size_t)y * MAP_COLUMNS + x];
+            if (!visits) continue;
+            top = std::min(top, y);
+            bottom = std::max(bottom, y);
+            left = std::min(left, x);
+            right = std::max(right, x);
+            peak = std::max(peak, visits);
+        }
+    }
+    if (bottom < 0) return;
+
+    // Heads sit on even columns; one character per two, shrunk to fit
+    static const char SHADES[] = " .:-=+*#%@";
+    const int MAX_WIDTH = 100, MAX_HEIGHT = 50;
+    int x_scale = std::max(2, ((right - left) / MAX_WIDTH + 1) * 2);
+    int y_scale = std::max(1, (bottom - top) / MAX_HEIGHT + 1);
+    printf("\nhead positions, rows %d-%d, columns %d-%d (%dx%d cells per character)\n",
+           top, bottom, left, right, y_scale, x_scale);
+    for (int y = top; y <= bottom; y += y_scale) {
+        std::string line;
+        for (int x = left; x <= right; x += x_scale) {
+            uint64_t visits = 0;
+            for (int dy = 0; dy < y_scale && y + dy < MAP_ROWS; ++dy) {
+                for (int dx = 0; dx < x_scale && x + dx < MAP_COLUMNS; ++dx) {
+                    visits = std::max(visits, stats.heat[(size_t)(y + dy) * MAP_COLUMNS + x + dx]);
+                }
+            }
+            int shade = visits ? 1 + (int)((sizeof(SHADES) - 3) * visits / peak) : 0;
+            line += SHADES[shade];
+        }
+        printf("  |%s|\n", line.c_str());
+    }
+}
+
+int main(int argc, char** argv) {
+    int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    const char* csv_path = nullptr;
+    const char* telemetry_dir = nullptr;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) csv_path = argv[++i];
+        else if (strcmp(argv[i], "--telemetry") == 0 && i + 1 < argc) telemetry_dir = argv[++i];
+        else if (argv[i][0] == '-') {
+            fprintf(stderr, "usage: replay_stats [--threads N] [--csv FILE] [--telemetry DIR] DIR|FILE...\n");
+            return 2;
+        } else {
+            collect_replays("replay_stats", argv[i], files);
+        }
+    }
+    std::sort(files.begin(), files.end());
+    if (files.empty()) {
+        fprintf(stderr, "replay_stats: no replays given\n");
+        return 2;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    std::atomic<size_t> next{0};
+    std::vector<CorpusStats> partial(threads);
+    // Results by file, so the table's rows follow the sorted file order
+    std::vector<GameResult> results(files.size());
+    std::vector<char> analyzed(files.size());
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            BoardScratch scratch;
+            size_t index;
+            while ((index = next.fetch_add(1)) < files.size()) {
+                analyzed[index] = analyze_file(files[index], partial[t], scratch, results[index]);
+                if (!analyzed[index]) partial[t].skipped++;
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    CorpusStats stats;
+    for (const auto& part : partial) stats.merge(part);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    printf("%llu replays (%llu skipped), %llu ticks, %.1f MB in %.2f s on %d threads: %.0f games/s, %.2e ticks/s\n",
+           (unsigned long long)stats.games, (unsigned long long)stats.skipped, (unsigned long long)stats.ticks,
+           stats.bytes / 1e6, seconds, threads, stats.games / seconds, stats.ticks / seconds);
+    if (stats.games == 0) return 1;
+
+    printf("\n%-8s%9s%9s%9s%9s%9s\n", "", "min", "p50", "p90", "p99", "max");
+    printf("%-8s%9llu%9llu%9llu%9llu%9llu\n", "score",
+           (unsigned long long)stats.scores.min(), (unsigned long long)stats.scores.percentile(50),
+           (unsigned long long)stats.scores.percentile(90), (unsigned long long)stats.scores.percentile(99),
+           (unsigned long long)stats.scores.max());
+    printf("%-8s%9llu%9llu%9llu%9llu%9llu\n", "length",
+           (unsigned long long)stats.lengths.min(), (unsigned long long)stats.lengths.percentile(50),
+           (unsigned long long)stats.lengths.percentile(90), (unsigned long long)stats.lengths.percentile(99),
+           (unsigned long long)stats.lengths.max());
+
+    printf("\ndeath causes:");
+    for (int i = 0; i < DEATHS; ++i) {
+        printf(" %s %llu (%.1f%%)", DEATH_NAMES[i], (unsigned long long)stats.deaths[i], 100.0 * stats.deaths[i] / stats.games);
+    }
+    printf("\n\nmean score of games still going at tick:\n");
+    for (int point = 1; point < CURVE_POINTS && stats.curve_games[point]; point *= 2) {
+        printf("  %7d  %8.2f  (%llu games)\n", point * CURVE_STEP,
+               (double)stats.curve_sum[point] / stats.curve_games[point], (unsigned long long)stats.curve_games[point]);
+    }
+    print_heatmap(stats);
+
+    if (csv_path) {
+        FILE* out = fopen(csv_path, "w");
+        if (!out) {
+            fprintf(stderr, "replay_stats: cannot write %s\n", csv_path);
+            return 1;
+        }
+        fprintf(out, "tick,games,mean_score\n");
+        for (int point = 0; point < CURVE_POINTS && stats.curve_games[point]; ++point) {
+            fprintf(out, "%d,%llu,%.4f\n", point * CURVE_STEP, (unsigned long long)stats.curve_games[point],
+                    (double)stats.curve_sum[point] / stats.curve_games[point]);
+        }
+        fclose(out);
+    }
+
+    // death holds the Death codes: 0 quit, 1 wall, 2 self
+    if (telemetry_dir) {
+        telemetry::TableWriter table;
+        if (!table.open(telemetry_dir, {"ticks", "score", "length", "death"})) {
+            fprintf(stderr, "replay_stats: cannot append to %s\n", telemetry_dir);
+            return 1;
+        }
+        for (size_t i = 0; i < files.size(); ++i) {
+            if (!analyzed[i]) continue;
+            const GameResult& result = results[i];
+            int64_t row[] = {result.ticks, result.score, result.length, result.death};
+            table.append(row);
+        }
+        if (!table.close()) {
+            fprintf(stderr, "replay_stats: cannot append to %s\n", telemetry_dir);
+            return 1;
+        }
+    }
+    return 0;
+}
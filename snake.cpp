@@ -1,120 +1,89 @@
 #include "curses.h"
-#include <random>
+#include "snake.h"
+#include "broadcast.h"
+#include "hud.h"
+#include "trace.h"
+#include "perf_counters.h"
+#include "watchdog.h"
+#include "realtime.h"
+#include "replay.h"
+#include "journal.h"
+#include "echo.h"
+#include "game.h"
 #include <chrono>
 #include <thread>
-#include <deque>
-#include <array>
+#include <csignal>
 
 TerminalUI ui;
 
+// Set by SIGINT/SIGTERM so the loop can restore the terminal and flush
+static volatile std::sig_atomic_t quit_requested = 0;
 
-class Tail {
-    private:
-        std::deque<std::array<int, 2>> body;
-        char character;
-    public:
-        Tail(char set_character, int y, int x) {
-            character = set_character;
-            body.push_back({y, x - 1});
-            body.push_back({y, x - 2});
-            body.push_back({y, x - 3});
-        }
-
-        void move(int new_y, int new_x) {
-            ui.mvaddch(body.back().at(0), body.back().at(1), ' ');
-            body.pop_back();
-            body.push_front({new_y, new_x});
-            ui.mvaddch(body.front().at(0), body.front().at(1), character);
-        }
-
-        void add(int new_y, int new_x) {
-            body.push_front({new_y, new_x});
-            ui.mvaddch(body.front().at(0), body.front().at(1), character);
-        }
+static void request_quit(int) {
+    quit_requested = 1;
+}
 
-};
-
-class Snake {
-    private: 
-        int x;
-        int y;
-        char head;
-        Tail tail;
-    public:
-        Snake(int set_x, int set_y, char set_head):
-            x{set_x}, y{set_y}, head{set_head},
-            tail{'#', set_y, set_x}{};
-
-        int get_x() { return x; }
-        int get_y() { return y; }
-
-        void move(int new_y, int new_x) {
-            ui.mvaddch(y, x,' ');
-            tail.move(y,x);
-            x = new_x;
-            y = new_y;
-            ui.mvaddch(y, x, head); 
-        }
-
-        void move_up() {
-            move(y - 1, x);
-        }
-        void move_down() {
-            move(y + 1, x);
-        }
-        void move_right() {
-            move(y, x + 2);
-        }
-        void move_left() {
-            move(y, x - 2);
+int main(int argc, char** argv) {
+    const char* serve_on = nullptr;
+    const char* trace_to = nullptr;
+    const char* watchdog_log = nullptr;
+    const char* record_to = nullptr;
+    const char* journal_to = nullptr;
+    std::vector<const char*> ghost_files;
+    bool use_perf = false;
+    bool realtime = false;
+    bool wrap = false;
+    double speed = 1.0;
+    long echo_delay = 0;
+    int realtime_cpu = -1;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+            serve_on = argv[++i];
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_to = argv[++i];
+        } else if (strcmp(argv[i], "--watchdog") == 0 && i + 1 < argc) {
+            watchdog_log = argv[++i];
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_to = argv[++i];
+        } else if (strcmp(argv[i], "--journal") == 0 && i + 1 < argc) {
+            journal_to = argv[++i];
+        } else if (strcmp(argv[i], "--ghost") == 0 && i + 1 < argc) {
+            ghost_files.push_back(argv[++i]);
+        } else if (strcmp(argv[i], "--rt") == 0 && i + 1 < argc) {
+            realtime = true;
+            realtime_cpu = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            speed = std::min(100.0, std::max(0.1, atof(argv[++i])));
+        } else if (strcmp(argv[i], "--echo") == 0 && i + 1 < argc) {
+            echo_delay = std::max(1L, atol(argv[++i]));
+        } else if (strcmp(argv[i], "--perf") == 0) {
+            use_perf = true;
+        } else if (strcmp(argv[i], "--wrap") == 0) {
+            wrap = true;
         }
+    }
 
-        void add_to_tail(int new_y, int new_x) {
-            tail.add(y, x);
-            x = new_x;
-            y = new_y;
-            ui.mvaddch(y, x, head);
-        }
-        void add_up() {
-            add_to_tail(y - 1, x);
-        }
-        void add_down() {
-            add_to_tail(y + 1, x);
-        }
-        void add_right() {
-            add_to_tail(y, x + 2);
-        }
-        void add_left() {
-            add_to_tail(y, x - 2);
-        }
-};
-
-class Food {
-    private: 
-        int x;
-        int y;
-        std::mt19937 gen;
-        char character;
-    public:
-        void place(int min, int max) {
-            std::random_device rd;
-            gen.seed(rd());
-            std::uniform_int_distribution<> intDist(min, max);
-            x = intDist(gen);
-            if(x % 2 == 1) x--;
-            y = intDist(gen);
-            ui.mvaddch(y, x ,character);
-        }
+    std::signal(SIGINT, request_quit);
+    std::signal(SIGTERM, request_quit);
+    if (trace_to) trace::start();
 
-        Food(char set_character, int min, int max): character(set_character) {
-            place(min, max);
-        };
+    // Per-phase hardware counters, summarised on exit
+    PerfGroup perf_group;
+    PerfGroup* perf = nullptr;
+    PhaseCounters input_phase, tick_phase, render_phase;
+    if (use_perf) {
+        if (perf_group.open()) perf = &perf_group;
+        else std::cerr << "snake: hardware counters unavailable, continuing without" << std::endl;
+    }
 
-        int get_x() { return x; }
-        int get_y() { return y; }
-};
+    #ifndef _WIN32
+    Broadcaster spectators;
+    if (serve_on && !spectators.listen_on(serve_on)) {
+        std::cerr << "snake: cannot serve spectators on " << serve_on << std::endl;
+        return 1;
+    }
+    #endif
 
-int main() {
     WINDOW* main_window = ui.initscr();    
     ui.curs_set(0);
     ui.noecho();
@@ -122,93 +91,291 @@ int main() {
     ui.cbreak();
     ui.keypad(true);
 
-    Snake my_snake(4, 2, '@');
-
     int input;
-    int direction = KEY_RIGHT;
 
+    // Steps of MOVE_DELAY game time, frames every MOVE_DELAY of wall time;
+    // --speed scales game time (see FrameClock)
     const int MOVE_DELAY = 100;
-    auto last_move = std::chrono::steady_clock::now();
+    const auto STEP = std::chrono::milliseconds(MOVE_DELAY);
+    const auto FRAME_INTERVAL = std::chrono::milliseconds(MOVE_DELAY);
+    const int MAX_STEPS_PER_FRAME = 1000;
+    FrameClock frame_clock(STEP, FRAME_INTERVAL, speed, MAX_STEPS_PER_FRAME);
 
     int terminal_x, terminal_y;
     ui.getmaxyx(main_window, terminal_y, terminal_x);
 
-    Food apple('O', 10, terminal_y - 10);
+    unsigned food_seed = std::random_device{}();
+    int food_min = 10, food_max = terminal_y - 10;
+
+    // A journal left by an earlier session is picked up where it stopped
+    #ifndef _WIN32
+    ReplayHeader resumed_header;
+    bool resuming = false, has_checkpoint = false;
+    JournalCheckpoint checkpoint;
+    std::vector<uint8_t> resumed_moves;
+    size_t journal_size = 0;
+    if (journal_to && access(journal_to, F_OK) == 0) {
+        if (!Journal::recover(journal_to, resumed_header, has_checkpoint, checkpoint, resumed_moves, journal_size)) {
+            ui.endwin();
+            std::cerr << "snake: " << journal_to << " is not a snake journal" << std::endl;
+            return 1;
+        }
+        resuming = true;
+        food_seed = resumed_header.food_seed;
+        food_min = resumed_header.food_min;
+        food_max = resumed_header.food_max;
+    }
+    #endif
+
+    Game game(2, 8, food_min, food_max, food_seed);
+
+    // Earlier runs to race against
+    for (const char* path : ghost_files) {
+        if (!game.ghosts.load(path)) {
+            ui.endwin();
+            std::cerr << "snake: cannot read replay " << path << std::endl;
+            return 1;
+        }
+    }
+
+    ReplayHeader replay_header = make_replay_header(food_seed, terminal_y, terminal_x,
+                                                    game.snake.get_y(), game.snake.get_x(), food_min, food_max,
+                                                    wrap ? REPLAY_WRAP : 0);
+    #ifndef _WIN32
+    if (resuming) replay_header = resumed_header;
+    #endif
+    // --wrap joins opposite edges; a resumed game keeps the board it started on
+    game.snake.set_topology(replay_topology(replay_header));
+    if (record_to && !game.recorder.open(record_to, replay_header)) {
+        ui.endwin();
+        std::cerr << "snake: cannot record to " << record_to << std::endl;
+        return 1;
+    }
+
+    #ifndef _WIN32
+    if (resuming) {
+        // Back to the checkpoint, then the moves after it; the recording
+        // and the ghosts get the whole game so they stay in step
+        size_t replay_from = 0;
+        if (has_checkpoint) {
+            game.apple.restore(checkpoint.food_y, checkpoint.food_x, checkpoint.placements, food_min, food_max);
+            std::vector<std::array<int, 2>> body;
+            from_chain(checkpoint.body, body, game.snake.get_topology());
+            game.snake.restore(checkpoint.head_y, checkpoint.head_x, body);
+            game.direction = checkpoint.direction;
+            replay_from = checkpoint.tick;
+        }
+        for (size_t i = 0; i < resumed_moves.size(); ++i) {
+            int move = decode_direction(resumed_moves[i]);
+            game.recorder.record(move);
+            game.ghosts.step();
+            if (i < replay_from) continue;
+            game.direction = move;
+            game_tick(game.snake, game.apple, game.direction, food_min, food_max);
+        }
+        game.journal_ticks = resumed_moves.size();
+    }
+    if (journal_to && !(resuming ? game.journal.append(journal_to, journal_size)
+                                 : game.journal.create(journal_to, replay_header))) {
+        ui.endwin();
+        std::cerr << "snake: cannot journal to " << journal_to << std::endl;
+        return 1;
+    }
+    #endif
+
+    // Temporal mode: running into the echo of the body from echo_delay
+    // ticks ago ends the game. A resumed game gets its echo back by
+    // rerunning the moves off screen.
+    if (echo_delay) {
+        game.echo_on = true;
+        #ifndef _WIN32
+        if (resuming) {
+            ReplaySim sim(resumed_header);
+            game.echo.start(sim, terminal_y, terminal_x, echo_delay);
+            for (uint8_t move : resumed_moves) {
+                game.echo.before(sim);
+                sim.step(decode_direction(move));
+                game.echo.after(sim);
+            }
+        } else
+        #endif
+        game.echo.start(game.snake, terminal_y, terminal_x, echo_delay);
+    }
+
+    // Toggled with 'f'
+    FrameHud hud;
+    sysio::Snapshot frame_start = sysio::snapshot();
+    bool input_pending = false;
+    auto input_time = frame_clock.next_frame();
+
+    // Slow-frame capture; a frame may run one poll interval and a little
+    // scheduling noise past MOVE_DELAY before it counts as an overrun
+    #ifndef _WIN32
+    TickWatchdog watchdog_instance;
+    TickWatchdog* watchdog = nullptr;
+    if (watchdog_log) {
+        watchdog = &watchdog_instance;
+        watchdog->start(MOVE_DELAY + 10);
+    }
+    unsigned long ticks = 0;
+    #endif
 
-    while(true) {
-        input = ui.getch();
+    // Real-time mode: everything the loop will touch is sized now, then
+    // locked in place before the first tick
+    RealtimeMode rt;
+    if (realtime) {
+        game.snake.reserve((size_t)terminal_y * terminal_x / 2 + 1);
+        ui.reserve_frame();
+        rt.enter(realtime_cpu);
+    }
+    // Wake this early and spin the rest of the way to the tick in real-time mode
+    const auto SPIN = std::chrono::microseconds(200);
+
+    // Setup (a journal replay above all) can take a while; the first frame
+    // shouldn't have to catch up with it
+    frame_clock.restart(std::chrono::steady_clock::now());
+    frame_start = sysio::snapshot();
+    #ifndef _WIN32
+    if (watchdog) watchdog->frame_begin();
+    #endif
+
+    while(!quit_requested && !game.caught) {
+        {
+            TRACE_SCOPE("getch");
+            PerfPhase phase(perf, input_phase);
+            #ifndef _WIN32
+            WatchdogPhase timed(watchdog, TickWatchdog::INPUT);
+            #endif
+            input = ui.getch();
+        }
 
         // ui.mvprintw(0, 0, "Key pressed: %d", input);
         // ui.refresh();
 
-        //if(input == KEY_RIGHT || input == KEY_LEFT || input == KEY_UP || input == KEY_DOWN) {
-            switch(input) {
-            case KEY_RIGHT:
-            case 'd':
-                direction = KEY_RIGHT;
-                break;
-            case KEY_LEFT:
-            case 'a':
-                direction = KEY_LEFT;
-                break;
-            case KEY_UP:
-            case 'w':
-                direction = KEY_UP;
-                break;
-            case KEY_DOWN:
-            case 's':
-                direction = KEY_DOWN;
-                break;
-            }
-        //}
+        if (input == 'f') hud.toggle();
+        else game.key(input);
+
+        if (input != ERR && !input_pending) {
+            input_pending = true;
+            input_time = std::chrono::steady_clock::now();
+        }
             
         auto current_time = std::chrono::steady_clock::now();
-        auto time_since_last_move = std::chrono::duration_cast<std::chrono::milliseconds>(current_time - last_move).count();
-
-        if(time_since_last_move >= MOVE_DELAY) {
-            if(my_snake.get_x() == apple.get_x() && my_snake.get_y() == apple.get_y()) {
-                switch(direction) {
-                case KEY_UP:
-                    my_snake.add_up();
-                    apple.place(10, terminal_y - 10);
-                    break;
-                case KEY_DOWN:
-                    my_snake.add_down();
-                    apple.place(10, terminal_y - 10);
-                    break;
-                case KEY_RIGHT:
-                    my_snake.add_right();
-                    apple.place(10, terminal_y - 10);
-                    break;
-                case KEY_LEFT:
-                    my_snake.add_left();
-                    apple.place(10, terminal_y - 10);
-                    break; 
-                }
+        auto next_frame = frame_clock.next_frame();
+        bool frame_due = frame_clock.frame_due(current_time);
+        int steps = frame_due ? frame_clock.advance(current_time) : 0;
+
+        // Slow motion has frames with nothing to step; they aren't drawn
+        if(steps > 0) {
+            {
+                TRACE_SCOPE("tick");
+                PerfPhase phase(perf, tick_phase);
+                #ifndef _WIN32
+                WatchdogPhase timed(watchdog, TickWatchdog::TICK);
+                #endif
+                game.tick(steps);
             }
-            
-            switch(direction) {
-            case KEY_UP:
-                my_snake.move_up();
-                break;
-            case KEY_DOWN:
-                my_snake.move_down();
-                break;
-            case KEY_RIGHT:
-                my_snake.move_right();
-                break;
-            case KEY_LEFT:
-                my_snake.move_left();
-                break;
+            auto ticked = std::chrono::steady_clock::now();
+
+            game.draw_overlays(hud, main_window);
+            {
+                TRACE_SCOPE("refresh");
+                PerfPhase phase(perf, render_phase);
+                #ifndef _WIN32
+                WatchdogPhase timed(watchdog, TickWatchdog::RENDER);
+                #endif
+                ui.refresh();
             }
+            auto rendered = std::chrono::steady_clock::now();
 
-            last_move = current_time;
-            ui.refresh();
+            hud.record_tick(std::chrono::duration_cast<std::chrono::nanoseconds>(ticked - current_time).count());
+            hud.record_render(std::chrono::duration_cast<std::chrono::nanoseconds>(rendered - ticked).count());
+            hud.record_bytes(ui.refresh_bytes());
+            if (input_pending) {
+                hud.record_input(std::chrono::duration_cast<std::chrono::nanoseconds>(rendered - input_time).count());
+                input_pending = false;
+            }
 
+            #ifndef _WIN32
+            if (serve_on) {
+                WatchdogPhase timed(watchdog, TickWatchdog::PUBLISH);
+                spectators.publish(main_window);
+            }
+            #endif
+            game.erase_overlays(hud);
         }
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        // Every frame interval closes a frame, drawn or not, so a slow-motion
+        // frame with nothing to step isn't counted as part of the next one
+        if (frame_due) {
+            hud.record_jitter(std::chrono::duration_cast<std::chrono::nanoseconds>(current_time - next_frame).count());
+            sysio::Snapshot frame_end = sysio::snapshot();
+            hud.record_syscalls(frame_end.since(frame_start));
+            frame_start = frame_end;
+
+            #ifndef _WIN32
+            ticks += steps;
+            if (watchdog) {
+                watchdog->frame_end({ticks, game.snake.get_y(), game.snake.get_x(), game.snake.get_length(),
+                                     game.direction});
+            }
+            #endif
+        }
+
+        {
+            #ifndef _WIN32
+            WatchdogPhase timed(watchdog, TickWatchdog::WAIT);
+            #endif
+            if (realtime) {
+                // Keep polling input every 5 ms but land on the frame itself
+                auto wake = std::min(std::chrono::steady_clock::now() + std::chrono::milliseconds(5),
+                                     frame_clock.next_frame());
+                std::this_thread::sleep_until(wake - SPIN);
+                while (std::chrono::steady_clock::now() < wake) {}
+            } else {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+        }
     }
 
     ui.endwin();
+
+    #ifndef _WIN32
+    if (journal_to && !game.journal.close()) {
+        std::cerr << "snake: writing the journal to " << journal_to << " failed" << std::endl;
+    }
+    // A finished game has nothing to resume
+    if (journal_to && game.caught) unlink(journal_to);
+    #endif
+
+    if (game.caught) {
+        std::cerr << "snake: caught by your echo from " << echo_delay << " ticks ago at tick "
+                  << game.echo.get_tick() << ", length " << game.snake.get_length() << std::endl;
+    }
+
+    if (realtime) std::cerr << "snake: real-time mode: " << rt.summary() << std::endl;
+
+    #ifndef _WIN32
+    if (watchdog) {
+        watchdog->stop();
+        FILE* out = fopen(watchdog_log, "w");
+        if (!out) {
+            std::cerr << "snake: cannot write watchdog log to " << watchdog_log << std::endl;
+            return 1;
+        }
+        watchdog->dump(out);
+        fclose(out);
+    }
+    #endif
+
+    if (perf) {
+        input_phase.print(stderr, "input");
+        tick_phase.print(stderr, "tick");
+        render_phase.print(stderr, "render");
+    }
+
+    if (trace_to && !trace::write_json(trace_to)) {
+        std::cerr << "snake: cannot write trace to " << trace_to << std::endl;
+        return 1;
+    }
 }
\ No newline at end of file
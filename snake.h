@@ -0,0 +1,275 @@
+#ifndef SNAKE_H
+#define SNAKE_H
+
+#include "curses.h"
+#include "trace.h"
+#include "body_storage.h"
+#include <random>
+#include <vector>
+#include <array>
+
+// Defined by the program that owns the terminal
+extern TerminalUI ui;
+
+// The body behind the head, stored however Storage (see body_storage.h)
+// keeps it
+template <typename Storage = BodyRing>
+class BasicTail {
+    private:
+        Storage body;
+        char character;
+    public:
+        BasicTail(char set_character, int y, int x) {
+            character = set_character;
+            // Spaced like a moving body, so every storage can hold it
+            body.push_back({y, x - 2});
+            body.push_back({y, x - 4});
+            body.push_back({y, x - 6});
+        }
+
+        void move(int new_y, int new_x) {
+            ui.mvaddch(body.back().at(0), body.back().at(1), ' ');
+            body.pop_back();
+            body.push_front({new_y, new_x});
+            ui.mvaddch(body.front().at(0), body.front().at(1), character);
+        }
+
+        void add(int new_y, int new_x) {
+            body.push_front({new_y, new_x});
+            ui.mvaddch(body.front().at(0), body.front().at(1), character);
+        }
+
+        size_t size() const { return body.size(); }
+        void reserve(size_t cells) { body.reserve(cells); }
+        void set_topology(const Topology& topology) { body.set_topology(topology); }
+        const Storage& cells() const { return body; }
+
+        // Swaps in a saved body, front first
+        void restore(const std::vector<std::array<int, 2>>& cells) {
+            for (size_t i = 0; i < body.size(); ++i) ui.mvaddch(body.at(i)[0], body.at(i)[1], ' ');
+            body.clear();
+            for (const auto& cell : cells) {
+                body.push_back(cell);
+                ui.mvaddch(cell[0], cell[1], character);
+            }
+        }
+};
+
+// The storage the game is built with; -DSNAKE_BODY_STORAGE=DequeBody or
+// SoABody picks another
+#ifndef SNAKE_BODY_STORAGE
+    #define SNAKE_BODY_STORAGE BodyRing
+#endif
+
+using Tail = BasicTail<SNAKE_BODY_STORAGE>;
+
+template <typename Storage = BodyRing>
+class BasicSnake {
+    private: 
+        int x;
+        int y;
+        char head;
+        BasicTail<Storage> tail;
+        Topology topology;
+    public:
+        BasicSnake(int set_x, int set_y, char set_head):
+            x{set_x}, y{set_y}, head{set_head},
+            tail{'#', set_y, set_x}{};
+
+        int get_x() { return x; }
+        int get_y() { return y; }
+        size_t get_length() const { return tail.size() + 1; }
+        void reserve(size_t cells) { tail.reserve(cells); }
+        const Storage& body() const { return tail.cells(); }
+
+        // Open edges unless set; on a torus every step wraps
+        void set_topology(const Topology& set_topology) {
+            topology = set_topology;
+            tail.set_topology(topology);
+        }
+        const Topology& get_topology() const { return topology; }
+
+        // Puts the snake back as it was saved
+        void restore(int new_y, int new_x, const std::vector<std::array<int, 2>>& cells) {
+            ui.mvaddch(y, x, ' ');
+            tail.restore(cells);
+            x = new_x;
+            y = new_y;
+            ui.mvaddch(y, x, head);
+        }
+
+        void move(int new_y, int new_x) {
+            TRACE_SCOPE("Snake::move");
+            ui.mvaddch(y, x,' ');
+            tail.move(y,x);
+            x = new_x;
+            y = new_y;
+            ui.mvaddch(y, x, head); 
+        }
+
+        void move_up() {
+            move(topology.wrap_y(y - 1), x);
+        }
+        void move_down() {
+            move(topology.wrap_y(y + 1), x);
+        }
+        void move_right() {
+            move(y, topology.wrap_x(x + 2));
+        }
+        void move_left() {
+            move(y, topology.wrap_x(x - 2));
+        }
+
+        void add_to_tail(int new_y, int new_x) {
+            tail.add(y, x);
+            x = new_x;
+            y = new_y;
+            ui.mvaddch(y, x, head);
+        }
+        void add_up() {
+            add_to_tail(topology.wrap_y(y - 1), x);
+        }
+        void add_down() {
+            add_to_tail(topology.wrap_y(y + 1), x);
+        }
+        void add_right() {
+            add_to_tail(y, topology.wrap_x(x + 2));
+        }
+        void add_left() {
+            add_to_tail(y, topology.wrap_x(x - 2));
+        }
+};
+
+using Snake = BasicSnake<SNAKE_BODY_STORAGE>;
+
+class Food {
+    private: 
+        int x;
+        int y;
+        std::mt19937 gen;
+        unsigned seed;
+        unsigned long placements;
+        char character;
+    public:
+        void place(int min, int max) {
+            TRACE_SCOPE("Food::place");
+            std::uniform_int_distribution<> intDist(min, max);
+            x = intDist(gen);
+            if(x % 2 == 1) x--;
+            y = intDist(gen);
+            placements++;
+            ui.mvaddch(y, x ,character);
+        }
+
+        void place_at(int new_y, int new_x) {
+            x = new_x;
+            y = new_y;
+            ui.mvaddch(y, x, character);
+        }
+
+        // Seeded once; pass a fixed seed for reproducible placement
+        Food(char set_character, int min, int max, unsigned set_seed = std::random_device{}()):
+            gen(set_seed), seed(set_seed), placements(0), character(set_character) {
+            place(min, max);
+        };
+
+        // Back to the state after `count` placements at (new_y, new_x); the
+        // generator is rewound and run through the same draws
+        void restore(int new_y, int new_x, unsigned long count, int min, int max) {
+            ui.mvaddch(y, x, ' ');
+            gen.seed(seed);
+            std::uniform_int_distribution<> intDist(min, max);
+            for (unsigned long i = 0; i < count; ++i) {
+                intDist(gen);
+                intDist(gen);
+            }
+            placements = count;
+            place_at(new_y, new_x);
+        }
+
+        int get_x() { return x; }
+        int get_y() { return y; }
+        unsigned long get_placements() const { return placements; }
+};
+
+// Turns typed between ticks, applied one per tick so a quick double turn
+// isn't lost. A turn is checked against the direction it will follow:
+// repeats and 180 degree reversals are dropped when typed, as are turns
+// beyond the first few.
+class InputQueue {
+    private:
+        static const int CAPACITY = 3;
+        int turns[CAPACITY];
+        int first;
+        int count;
+
+        static bool opposite(int a, int b) {
+            return (a == KEY_UP && b == KEY_DOWN) || (a == KEY_DOWN && b == KEY_UP) ||
+                   (a == KEY_LEFT && b == KEY_RIGHT) || (a == KEY_RIGHT && b == KEY_LEFT);
+        }
+    public:
+        InputQueue(): first(0), count(0) {}
+
+        // direction is the one the snake is moving in now; true if queued
+        bool push(int turn, int direction) {
+            int after = count ? turns[(first + count - 1) % CAPACITY] : direction;
+            if (count == CAPACITY || turn == after || opposite(turn, after)) return false;
+            turns[(first + count) % CAPACITY] = turn;
+            count++;
+            return true;
+        }
+
+        // The direction for the next tick
+        int next(int direction) {
+            if (!count) return direction;
+            int turn = turns[first];
+            first = (first + 1) % CAPACITY;
+            count--;
+            return turn;
+        }
+
+        bool empty() const { return count == 0; }
+        void clear() { count = 0; }
+};
+
+// One game tick: eat if the head is on the apple, then take a step
+template <typename Storage>
+inline void game_tick(BasicSnake<Storage>& snake, Food& apple, int direction, int food_min, int food_max) {
+    if(snake.get_x() == apple.get_x() && snake.get_y() == apple.get_y()) {
+        switch(direction) {
+        case KEY_UP:
+            snake.add_up();
+            apple.place(food_min, food_max);
+            break;
+        case KEY_DOWN:
+            snake.add_down();
+            apple.place(food_min, food_max);
+            break;
+        case KEY_RIGHT:
+            snake.add_right();
+            apple.place(food_min, food_max);
+            break;
+        case KEY_LEFT:
+            snake.add_left();
+            apple.place(food_min, food_max);
+            break; 
+        }
+    }
+    
+    switch(direction) {
+    case KEY_UP:
+        snake.move_up();
+        break;
+    case KEY_DOWN:
+        snake.move_down();
+        break;
+    case KEY_RIGHT:
+        snake.move_right();
+        break;
+    case KEY_LEFT:
+        snake.move_left();
+        break;
+    }
+}
+
+#endif // SNAKE_H
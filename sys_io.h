@@ -0,0 +1,163 @@
+#ifndef SNAKE_SYS_IO_H
+#define SNAKE_SYS_IO_H
+
+// Counted wrappers for the system calls behind a frame
+//
+// All terminal and socket I/O goes through these, so the number of calls a
+// frame costs can be read off the counters without ptrace or seccomp.
+// system() is counted as one "spawn" although it costs a fork, an exec and
+// a wait underneath.
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <streambuf>
+
+#ifndef _WIN32
+    #include <termios.h>
+    #include <unistd.h>
+    #include <sys/ioctl.h>
+    #include <sys/uio.h>
+    #include <cerrno>
+#endif
+
+namespace sysio {
+
+enum Call { READ, WRITE, WRITEV, TCGETATTR, TCSETATTR, IOCTL, SPAWN, CALL_KINDS };
+
+inline const char* const NAMES[CALL_KINDS] = {"read", "write", "writev", "tcgetattr", "tcsetattr", "ioctl", "spawn"};
+inline const char* const SHORT_NAMES[CALL_KINDS] = {"r", "w", "wv", "tg", "ts", "io", "sp"};
+
+inline std::atomic<uint64_t> counts[CALL_KINDS];
+
+inline void count(Call call) {
+    counts[call].fetch_add(1, std::memory_order_relaxed);
+}
+
+struct Snapshot {
+    uint64_t calls[CALL_KINDS];
+
+    uint64_t total() const {
+        uint64_t sum = 0;
+        for (uint64_t c : calls) sum += c;
+        return sum;
+    }
+
+    Snapshot since(const Snapshot& earlier) const {
+        Snapshot delta;
+        for (int i = 0; i < CALL_KINDS; ++i) delta.calls[i] = calls[i] - earlier.calls[i];
+        return delta;
+    }
+};
+
+inline Snapshot snapshot() {
+    Snapshot now;
+    for (int i = 0; i < CALL_KINDS; ++i) now.calls[i] = counts[i].load(std::memory_order_relaxed);
+    return now;
+}
+
+inline int system(const char* command) {
+    count(SPAWN);
+    return ::system(command);
+}
+
+#ifndef _WIN32
+
+inline ssize_t read(int fd, void* buffer, size_t size) {
+    count(READ);
+    return ::read(fd, buffer, size);
+}
+
+inline ssize_t write(int fd, const void* buffer, size_t size) {
+    count(WRITE);
+    return ::write(fd, buffer, size);
+}
+
+inline ssize_t writev(int fd, const struct iovec* iov, int iovcnt) {
+    count(WRITEV);
+    return ::writev(fd, iov, iovcnt);
+}
+
+inline int tcgetattr(int fd, struct termios* termios) {
+    count(TCGETATTR);
+    return ::tcgetattr(fd, termios);
+}
+
+inline int tcsetattr(int fd, int actions, const struct termios* termios) {
+    count(TCSETATTR);
+    return ::tcsetattr(fd, actions, termios);
+}
+
+inline int ioctl_winsize(int fd, struct winsize* size) {
+    count(IOCTL);
+    return ::ioctl(fd, TIOCGWINSZ, size);
+}
+
+// Buffered output stream over a file descriptor whose writes are counted
+class FdBuffer : public std::streambuf {
+    private:
+        static const size_t SIZE = 4096;
+        int fd;
+        char buffer[SIZE];
+
+        bool write_all(const char* data, size_t size) {
+            while (size > 0) {
+                ssize_t written = sysio::write(fd, data, size);
+                if (written < 0) {
+                    if (errno == EINTR) continue;
+                    return false;
+                }
+                data += written;
+                size -= written;
+            }
+            return true;
+        }
+
+        bool drain() {
+            size_t pending = pptr() - pbase();
+            setp(buffer, buffer + SIZE);
+            return write_all(buffer, pending);
+        }
+
+    protected:
+        int overflow(int ch) override {
+            if (!drain()) return traits_type::eof();
+            if (ch != traits_type::eof()) {
+                *pptr() = (char)ch;
+                pbump(1);
+            }
+            return traits_type::not_eof(ch);
+        }
+
+        // Large writes bypass the buffer: one frame, one write()
+        std::streamsize xsputn(const char* data, std::streamsize size) override {
+            if ((size_t)size <= (size_t)(epptr() - pptr())) {
+                memcpy(pptr(), data, size);
+                pbump((int)size);
+                return size;
+            }
+            if (!drain() || !write_all(data, size)) return 0;
+            return size;
+        }
+
+        int sync() override { return drain() ? 0 : -1; }
+
+    public:
+        explicit FdBuffer(int set_fd): fd(set_fd) { setp(buffer, buffer + SIZE); }
+        ~FdBuffer() override { drain(); }
+};
+
+#endif // _WIN32
+
+// Output stream that discards everything written to it, for rendering
+// off-screen (benchmarks, the allocation check)
+class NullBuffer : public std::streambuf {
+    protected:
+        int overflow(int ch) override { return ch; }
+        std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+};
+
+} // namespace sysio
+
+#endif // SNAKE_SYS_IO_H
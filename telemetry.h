@@ -0,0 +1,214 @@
+#ifndef SNAKE_TELEMETRY_H
+#define SNAKE_TELEMETRY_H
+
+// Append-only columnar telemetry (POSIX only)
+//
+// A table is a directory with two files per metric: NAME.col holds the
+// values as native-endian int64, one per game, and NAME.zone the min and
+// max of every complete block of BLOCK_ROWS values. Appending only ever
+// adds to the ends of files. Readers map the files and use the zone maps
+// to skip whole blocks a filter cannot match; the last, incomplete block
+// has no zone entry and is always scanned.
+
+#ifndef _WIN32
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace telemetry {
+
+static const size_t BLOCK_ROWS = 4096;
+
+struct Zone {
+    int64_t min;
+    int64_t max;
+};
+
+inline std::string column_path(const std::string& dir, const std::string& name, const char* suffix) {
+    return dir + "/" + name + suffix;
+}
+
+inline size_t file_size(const std::string& path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 ? (size_t)info.st_size : 0;
+}
+
+class ColumnWriter {
+    private:
+        FILE* values;
+        FILE* zones;
+        size_t rows;
+        Zone pending;
+
+    public:
+        ColumnWriter(): values(nullptr), zones(nullptr), rows(0), pending{INT64_MAX, INT64_MIN} {}
+        ~ColumnWriter() { close(); }
+        ColumnWriter(const ColumnWriter&) = delete;
+        ColumnWriter& operator=(const ColumnWriter&) = delete;
+
+        // Opens for appending after the first `keep` rows, dropping any
+        // rows (and zones) past that left by an interrupted append
+        bool open(const std::string& dir, const std::string& name, size_t keep) {
+            std::string values_path = column_path(dir, name, ".col");
+            std::string zones_path = column_path(dir, name, ".zone");
+            if (file_size(values_path) > keep * sizeof(int64_t) && truncate(values_path.c_str(), keep * sizeof(int64_t)) != 0) {
+                return false;
+            }
+            values = fopen(values_path.c_str(), "a+b");
+            if (!values) return false;
+            rows = keep;
+
+            // Zones of the complete blocks: trim extras, rebuild if some are missing
+            size_t complete = rows / BLOCK_ROWS;
+            size_t have = file_size(zones_path) / sizeof(Zone);
+            std::vector<int64_t> block(BLOCK_ROWS);
+            if (have > complete && truncate(zones_path.c_str(), complete * sizeof(Zone)) != 0) return false;
+            zones = fopen(zones_path.c_str(), have < complete ? "wb" : "ab");
+            if (!zones) return false;
+            if (have < complete) {
+                fseek(values, 0, SEEK_SET);
+                for (size_t b = 0; b < complete; ++b) {
+                    if (fread(block.data(), sizeof(int64_t), BLOCK_ROWS, values) != BLOCK_ROWS) return false;
+                    auto range = std::minmax_element(block.begin(), block.end());
+                    Zone zone = {*range.first, *range.second};
+                    fwrite(&zone, sizeof(zone), 1, zones);
+                }
+            }
+
+            // Min and max of the incomplete last block so far
+            pending = {INT64_MAX, INT64_MIN};
+            size_t partial = rows % BLOCK_ROWS;
+            if (partial) {
+                fseek(values, (long)(complete * BLOCK_ROWS * sizeof(int64_t)), SEEK_SET);
+                if (fread(block.data(), sizeof(int64_t), partial, values) != partial) return false;
+                for (size_t i = 0; i < partial; ++i) {
+                    pending.min = std::min(pending.min, block[i]);
+                    pending.max = std::max(pending.max, block[i]);
+                }
+            }
+            return true;
+        }
+
+        // Rows already in a column file
+        static size_t stored_rows(const std::string& dir, const std::string& name) {
+            return file_size(column_path(dir, name, ".col")) / sizeof(int64_t);
+        }
+
+        void append(int64_t value) {
+            fwrite(&value, sizeof(value), 1, values);
+            pending.min = std::min(pending.min, value);
+            pending.max = std::max(pending.max, value);
+            if (++rows % BLOCK_ROWS == 0) {
+                fwrite(&pending, sizeof(pending), 1, zones);
+                pending = {INT64_MAX, INT64_MIN};
+            }
+        }
+
+        bool close() {
+            bool ok = true;
+            if (values) ok = fclose(values) == 0 && ok;
+            if (zones) ok = fclose(zones) == 0 && ok;
+            values = zones = nullptr;
+            return ok;
+        }
+};
+
+// One row per game across a fixed set of columns
+class TableWriter {
+    private:
+        std::vector<std::string> names;
+        std::vector<ColumnWriter> columns;
+
+    public:
+        // Creates the directory if needed; columns are trimmed to the
+        // shortest so every row is whole
+        bool open(const std::string& dir, const std::vector<std::string>& set_names) {
+            mkdir(dir.c_str(), 0755);
+            names = set_names;
+            size_t rows = SIZE_MAX;
+            for (const auto& name : names) rows = std::min(rows, ColumnWriter::stored_rows(dir, name));
+            columns = std::vector<ColumnWriter>(names.size());
+            for (size_t i = 0; i < names.size(); ++i) {
+                if (!columns[i].open(dir, names[i], rows)) return false;
+            }
+            return true;
+        }
+
+        // values[i] goes to the i-th column given to open()
+        void append(const int64_t* values) {
+            for (size_t i = 0; i < columns.size(); ++i) columns[i].append(values[i]);
+        }
+
+        bool close() {
+            bool ok = true;
+            for (auto& column : columns) ok = column.close() && ok;
+            return ok;
+        }
+};
+
+// A column mapped for reading
+class Column {
+    private:
+        void* values_map;
+        size_t values_size;
+        void* zones_map;
+        size_t zones_size;
+
+        static void* map(const std::string& path, size_t& size) {
+            size = 0;
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) return nullptr;
+            struct stat info;
+            void* mapped = nullptr;
+            if (fstat(fd, &info) == 0 && info.st_size > 0) {
+                size = info.st_size;
+                mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+                if (mapped == MAP_FAILED) {
+                    mapped = nullptr;
+                    size = 0;
+                }
+            }
+            ::close(fd);
+            return mapped;
+        }
+
+    public:
+        Column(): values_map(nullptr), values_size(0), zones_map(nullptr), zones_size(0) {}
+        ~Column() {
+            if (values_map) munmap(values_map, values_size);
+            if (zones_map) munmap(zones_map, zones_size);
+        }
+        Column(const Column&) = delete;
+        Column& operator=(const Column&) = delete;
+
+        bool open(const std::string& dir, const std::string& name) {
+            std::string path = column_path(dir, name, ".col");
+            if (access(path.c_str(), R_OK) != 0) return false;
+            values_map = map(path, values_size);
+            zones_map = map(column_path(dir, name, ".zone"), zones_size);
+            return true;
+        }
+
+        const int64_t* values() const { return (const int64_t*)values_map; }
+        size_t rows() const { return values_size / sizeof(int64_t); }
+
+        // Zone of block b, or nullptr for a block without one
+        const Zone* zone(size_t block) const {
+            if ((block + 1) * sizeof(Zone) > zones_size) return nullptr;
+            return (const Zone*)zones_map + block;
+        }
+};
+
+} // namespace telemetry
+
+#endif // _WIN32
+
+#endif // SNAKE_TELEMETRY_H
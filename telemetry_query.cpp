@@ -0,0 +1,221 @@
+// Filter and aggregate a telemetry table
+//
+//   g++ -std=c++17 -O3 telemetry_query.cpp -o telemetry_query
+//   ./telemetry_query DIR [--where COLUMN OP VALUE]... [--agg FN:COLUMN]...
+//
+// OP is one of < <= > >= == !=, FN one of sum avg min max; the count of
+// matching games is always printed. Tables from replay_stats have one row
+// per game with the columns ticks (the whole game), score and length (at
+// the end) and death. For example, the average final length of games that
+// ended with a score over 100 and lasted under 5,000 ticks:
+//
+//   ./telemetry_query games --where score '>' 100 --where ticks '<' 5000 --agg avg:length
+//
+// The scan goes a block at a time. A filter whose zone map rules the block
+// out skips it, one the zone map proves true for the whole block is not
+// evaluated, and the rest run as branch-free loops over the column that
+// the compiler vectorises, building a byte mask the aggregates then use.
+
+#include "telemetry.h"
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+
+using telemetry::BLOCK_ROWS;
+using telemetry::Column;
+using telemetry::Zone;
+
+enum Op { LT, LE, GT, GE, EQ, NE };
+
+struct Filter {
+    std::string column;
+    Op op;
+    int64_t value;
+    Column* data;
+};
+
+enum Fn { SUM, AVG, MIN, MAX };
+
+struct Aggregate {
+    std::string column;
+    Fn fn;
+    Column* data;
+    int64_t sum = 0;
+    int64_t min = INT64_MAX;
+    int64_t max = INT64_MIN;
+};
+
+static bool parse_op(const char* text, Op& op) {
+    static const char* const NAMES[] = {"<", "<=", ">", ">=", "==", "!="};
+    for (int i = 0; i < 6; ++i) {
+        if (strcmp(text, NAMES[i]) == 0) {
+            op = (Op)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool parse_fn(const std::string& text, Fn& fn) {
+    static const char* const NAMES[] = {"sum", "avg", "min", "max"};
+    for (int i = 0; i < 4; ++i) {
+        if (text == NAMES[i]) {
+            fn = (Fn)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// 1 if the filter may match somewhere in [min, max], 2 if it matches all of it
+static int zone_test(const Filter& filter, const Zone& zone) {
+    int64_t v = filter.value;
+    bool any, all;
+    switch (filter.op) {
+        case LT: any = zone.min < v; all = zone.max < v; break;
+        case LE: any = zone.min <= v; all = zone.max <= v; break;
+        case GT: any = zone.max > v; all = zone.min > v; break;
+        case GE: any = zone.max >= v; all = zone.min >= v; break;
+        case EQ: any = zone.min <= v && v <= zone.max; all = zone.min == v && zone.max == v; break;
+        default: any = !(zone.min == v && zone.max == v); all = v < zone.min || v > zone.max; break;
+    }
+    return all ? 2 : any ? 1 : 0;
+}
+
+// mask[i] &= (values[i] OP value), one loop per operator so each vectorises
+static void apply(Op op, const int64_t* values, int64_t value, uint8_t* mask, size_t count) {
+    switch (op) {
+        case LT: for (size_t i = 0; i < count; ++i) mask[i] &= values[i] < value; break;
+        case LE: for (size_t i = 0; i < count; ++i) mask[i] &= values[i] <= value; break;
+        case GT: for (size_t i = 0; i < count; ++i) mask[i] &= values[i] > value; break;
+        case GE: for (size_t i = 0; i < count; ++i) mask[i] &= values[i] >= value; break;
+        case EQ: for (size_t i = 0; i < count; ++i) mask[i] &= values[i] == value; break;
+        case NE: for (size_t i = 0; i < count; ++i) mask[i] &= values[i] != value; break;
+    }
+}
+
+static void usage() {
+    fprintf(stderr, "usage: telemetry_query DIR [--where COLUMN OP VALUE]... [--agg sum|avg|min|max:COLUMN]...\n");
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        usage();
+        return 2;
+    }
+    std::string dir = argv[1];
+    std::vector<Filter> filters;
+    std::vector<Aggregate> aggregates;
+    for (int i = 2; i < argc; ++i) {
+        if (strcmp(argv[i], "--where") == 0 && i + 3 < argc) {
+            Filter filter;
+            filter.column = argv[i + 1];
+            if (!parse_op(argv[i + 2], filter.op)) {
+                fprintf(stderr, "telemetry_query: unknown operator %s\n", argv[i + 2]);
+                return 2;
+            }
+            filter.value = strtoll(argv[i + 3], nullptr, 10);
+            filters.push_back(filter);
+            i += 3;
+        } else if (strcmp(argv[i], "--agg") == 0 && i + 1 < argc) {
+            std::string spec = argv[++i];
+            size_t colon = spec.find(':');
+            Aggregate aggregate;
+            if (colon == std::string::npos || !parse_fn(spec.substr(0, colon), aggregate.fn)) {
+                fprintf(stderr, "telemetry_query: bad aggregate %s\n", spec.c_str());
+                return 2;
+            }
+            aggregate.column = spec.substr(colon + 1);
+            aggregates.push_back(aggregate);
+        } else {
+            usage();
+            return 2;
+        }
+    }
+
+    // Each column is mapped once however often it is used
+    std::vector<std::string> names;
+    for (const auto& filter : filters) names.push_back(filter.column);
+    for (const auto& aggregate : aggregates) names.push_back(aggregate.column);
+    if (names.empty()) {
+        fprintf(stderr, "telemetry_query: nothing to scan\n");
+        return 2;
+    }
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+    std::vector<Column> columns(names.size());
+    size_t rows = SIZE_MAX;
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (!columns[i].open(dir, names[i])) {
+            fprintf(stderr, "telemetry_query: no column %s in %s\n", names[i].c_str(), dir.c_str());
+            return 1;
+        }
+        rows = std::min(rows, columns[i].rows());
+    }
+    auto lookup = [&](const std::string& name) {
+        return &columns[std::lower_bound(names.begin(), names.end(), name) - names.begin()];
+    };
+    for (auto& filter : filters) filter.data = lookup(filter.column);
+    for (auto& aggregate : aggregates) aggregate.data = lookup(aggregate.column);
+
+    auto started = std::chrono::steady_clock::now();
+    uint64_t matched = 0;
+    size_t skipped_blocks = 0, blocks = 0;
+    uint8_t mask[BLOCK_ROWS];
+    std::vector<char> needed(filters.size());
+    for (size_t start = 0; start < rows; start += BLOCK_ROWS) {
+        size_t count = std::min(BLOCK_ROWS, rows - start);
+        size_t block = start / BLOCK_ROWS;
+        blocks++;
+
+        // Zone maps first: a block no filter can match costs nothing
+        bool skip = false;
+        for (size_t f = 0; f < filters.size() && !skip; ++f) {
+            const Zone* zone = count == BLOCK_ROWS ? filters[f].data->zone(block) : nullptr;
+            int test = zone ? zone_test(filters[f], *zone) : 1;
+            skip = test == 0;
+            needed[f] = test == 1;
+        }
+        if (skip) {
+            skipped_blocks++;
+            continue;
+        }
+
+        memset(mask, 1, count);
+        for (size_t f = 0; f < filters.size(); ++f) {
+            if (needed[f]) apply(filters[f].op, filters[f].data->values() + start, filters[f].value, mask, count);
+        }
+
+        uint64_t block_matches = 0;
+        for (size_t i = 0; i < count; ++i) block_matches += mask[i];
+        matched += block_matches;
+        if (!block_matches) continue;
+        for (auto& aggregate : aggregates) {
+            const int64_t* values = aggregate.data->values() + start;
+            int64_t sum = 0, low = INT64_MAX, high = INT64_MIN;
+            for (size_t i = 0; i < count; ++i) {
+                int64_t keep = -(int64_t)mask[i];
+                sum += values[i] & keep;
+                low = std::min(low, mask[i] ? values[i] : INT64_MAX);
+                high = std::max(high, mask[i] ? values[i] : INT64_MIN);
+            }
+            aggregate.sum += sum;
+            aggregate.min = std::min(aggregate.min, low);
+            aggregate.max = std::max(aggregate.max, high);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    printf("count %llu\n", (unsigned long long)matched);
+    for (const auto& aggregate : aggregates) {
+        static const char* const FN_NAMES[] = {"sum", "avg", "min", "max"};
+        printf("%s:%s ", FN_NAMES[aggregate.fn], aggregate.column.c_str());
+        if (!matched) printf("-\n");
+        else if (aggregate.fn == SUM) printf("%lld\n", (long long)aggregate.sum);
+        else if (aggregate.fn == AVG) printf("%.4f\n", (double)aggregate.sum / matched);
+        else printf("%lld\n", (long long)(aggregate.fn == MIN ? aggregate.min : aggregate.max));
+    }
+    fprintf(stderr, "scanned %zu rows in %.3f s, %zu of %zu blocks skipped by zone maps\n",
+            rows, seconds, skipped_blocks, blocks);
+    return 0;
+}
@@ -0,0 +1,54 @@
+#ifndef SNAKE_TOPOLOGY_H
+#define SNAKE_TOPOLOGY_H
+
+// How the edges of the board join up
+//
+// An open board (the default) has edges the snake can leave by. A torus
+// joins each edge to the opposite one, so a step off the right edge comes
+// back in at the left. Wrapping uses masks, not branches: a comparison
+// gives 0 or all ones, and that picks whether the size is added, taken
+// away, or neither. A step costs the same few instructions whether or not
+// it crosses an edge. An open board has sizes of 0, runs the same code and
+// comes out unchanged, so callers never ask which kind of board they are on.
+//
+// Columns wrap over an even width because the snake only stands on even
+// columns. On an odd-width terminal the last column is left unused.
+
+struct Topology {
+    int height;     // rows wrapped over, 0 for open edges
+    int width;      // columns wrapped over, even; 0 for open edges
+
+    Topology(): height(0), width(0) {}
+
+    static Topology torus(int set_height, int set_width) {
+        Topology topology;
+        topology.height = set_height;
+        topology.width = set_width & ~1;
+        return topology;
+    }
+
+    bool wraps() const { return height != 0; }
+
+    // Brings back a coordinate that is at most one board outside
+    int wrap_y(int y) const { return wrap(y, height); }
+    int wrap_x(int x) const { return wrap(x, width); }
+
+    // Signed distance from one coordinate to another, taking the route
+    // over the edge when it is shorter
+    int delta_y(int from, int to) const { return shortest(to - from, height); }
+    int delta_x(int from, int to) const { return shortest(to - from, width); }
+
+    static int wrap(int value, int size) {
+        value += size & -(int)(value < 0);
+        value -= size & -(int)(value >= size);
+        return value;
+    }
+
+    static int shortest(int delta, int size) {
+        delta -= size & -(int)(2 * delta > size);
+        delta += size & -(int)(2 * delta < -size);
+        return delta;
+    }
+};
+
+#endif // SNAKE_TOPOLOGY_H
@@ -0,0 +1,131 @@
+#ifndef SNAKE_TRACE_H
+#define SNAKE_TRACE_H
+
+// Scoped trace spans exported as Chrome/Perfetto trace JSON
+//
+//   TRACE_SCOPE("refresh");
+//
+// Each thread records into its own fixed-size ring buffer (oldest spans are
+// overwritten), so recording takes no locks. Until trace::start() is called a
+// span costs one relaxed atomic load; building with -DSNAKE_NO_TRACING
+// removes spans entirely. trace::write_json() dumps every ring for
+// chrome://tracing or ui.perfetto.dev.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+namespace trace {
+
+struct Event {
+    const char* name;
+    uint64_t begin_ns;
+    uint64_t end_ns;
+};
+
+class Ring {
+    public:
+        static const size_t CAPACITY = 1 << 16;
+
+        Ring(uint32_t set_tid): head(0), tid(set_tid), events(new Event[CAPACITY]) {}
+
+        // Only ever called by the owning thread
+        void push(const char* name, uint64_t begin_ns, uint64_t end_ns) {
+            uint64_t at = head.load(std::memory_order_relaxed);
+            events[at & (CAPACITY - 1)] = {name, begin_ns, end_ns};
+            head.store(at + 1, std::memory_order_release);
+        }
+
+        template <typename Fn>
+        void for_each(Fn fn) const {
+            uint64_t end = head.load(std::memory_order_acquire);
+            uint64_t begin = end > CAPACITY ? end - CAPACITY : 0;
+            for (uint64_t i = begin; i < end; ++i) fn(events[i & (CAPACITY - 1)]);
+        }
+
+        uint32_t thread_id() const { return tid; }
+
+    private:
+        std::atomic<uint64_t> head;
+        uint32_t tid;
+        std::unique_ptr<Event[]> events;
+};
+
+inline std::atomic<bool> enabled{false};
+inline std::mutex registry_lock;
+inline std::vector<std::unique_ptr<Ring>> registry;
+
+inline uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// The calling thread's ring, registered on first use
+inline Ring& local_ring() {
+    thread_local Ring* ring = nullptr;
+    if (!ring) {
+        std::lock_guard<std::mutex> guard(registry_lock);
+        registry.emplace_back(new Ring((uint32_t)registry.size() + 1));
+        ring = registry.back().get();
+    }
+    return *ring;
+}
+
+inline void start() { enabled.store(true, std::memory_order_relaxed); }
+inline void stop() { enabled.store(false, std::memory_order_relaxed); }
+
+class Span {
+    private:
+        const char* name;
+        uint64_t begin_ns;
+    public:
+        explicit Span(const char* set_name):
+            name(enabled.load(std::memory_order_relaxed) ? set_name : nullptr), begin_ns(name ? now_ns() : 0) {}
+        ~Span() {
+            if (name) local_ring().push(name, begin_ns, now_ns());
+        }
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+};
+
+// Chrome trace event format: complete ("X") events with microsecond times
+inline bool write_json(const char* path) {
+    FILE* out = fopen(path, "w");
+    if (!out) return false;
+
+    std::lock_guard<std::mutex> guard(registry_lock);
+    uint64_t origin = UINT64_MAX;
+    for (const auto& ring : registry) {
+        ring->for_each([&](const Event& e) { origin = std::min(origin, e.begin_ns); });
+    }
+
+    fprintf(out, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+    bool first = true;
+    for (const auto& ring : registry) {
+        ring->for_each([&](const Event& e) {
+            fprintf(out, "%s{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}",
+                    first ? "" : ",\n", e.name, ring->thread_id(),
+                    (e.begin_ns - origin) / 1000.0, (e.end_ns - e.begin_ns) / 1000.0);
+            first = false;
+        });
+    }
+    fprintf(out, "\n]}\n");
+    return fclose(out) == 0;
+}
+
+} // namespace trace
+
+#ifdef SNAKE_NO_TRACING
+    #define TRACE_SCOPE(name) do {} while (0)
+#else
+    #define TRACE_CONCAT_INNER(a, b) a##b
+    #define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+    #define TRACE_SCOPE(name) trace::Span TRACE_CONCAT(trace_span_, __LINE__)(name)
+#endif
+
+#endif // SNAKE_TRACE_H
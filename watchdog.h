@@ -0,0 +1,223 @@
+#ifndef SNAKE_WATCHDOG_H
+#define SNAKE_WATCHDOG_H
+
+// Tick-budget watchdog (POSIX only)
+//
+// The main loop reports how long each phase of a frame took (input polling,
+// waiting, tick, render, publish). A frame that runs past its budget is
+// logged with that breakdown and a snapshot of the game state into a bounded
+// log that is written out at exit. A separate thread watches the frame in
+// progress; once it is over budget, the thread interrupts the game thread
+// with SIGUSR2 and the handler grabs a stack sample of whatever is stalling.
+
+#ifndef _WIN32
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <csignal>
+#include <algorithm>
+#include <pthread.h>
+#include <execinfo.h>
+#include <unistd.h>
+
+class TickWatchdog {
+    public:
+        enum Phase { INPUT, WAIT, TICK, RENDER, PUBLISH, PHASES };
+
+        struct State {
+            unsigned long tick;
+            int head_y;
+            int head_x;
+            size_t length;
+            int direction;
+        };
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        static const int MAX_FRAMES = 32;
+        static const int LOG_SIZE = 64;
+
+        struct SlowTick {
+            State state;
+            int64_t elapsed_ns;
+            int64_t phase_ns[PHASES];
+            void* stack[MAX_FRAMES];
+            int depth;
+        };
+
+        enum Sample { IDLE, REQUESTED, TAKEN };
+
+        int64_t budget_ns;
+        Clock::time_point frame_start;
+        int64_t phase_ns[PHASES];
+
+        // Written by the game thread only; read once everything has stopped
+        SlowTick log[LOG_SIZE];
+        unsigned long logged;
+        unsigned long frames;
+        unsigned long overruns;
+
+        // Shared with the watchdog thread and the signal handler
+        std::atomic<int64_t> frame_start_ns;   // 0 between frames
+        std::atomic<unsigned long> frame_id;
+        std::atomic<int> sample_state;
+        void* sample_stack[MAX_FRAMES];
+        int sample_depth;
+
+        pthread_t game_thread;
+        std::atomic<bool> running;
+        std::thread watcher;
+
+        static TickWatchdog*& active() {
+            static TickWatchdog* instance = nullptr;
+            return instance;
+        }
+
+        static int64_t to_ns(Clock::time_point t) {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+        }
+
+        static void on_sample_signal(int) {
+            TickWatchdog* self = active();
+            if (!self) return;
+            if (self->sample_state.load() != REQUESTED) return;
+            self->sample_depth = backtrace(self->sample_stack, MAX_FRAMES);
+            self->sample_state.store(TAKEN);
+        }
+
+        void watch() {
+            unsigned long sampled = (unsigned long)-1;
+            auto interval = std::chrono::nanoseconds(std::max<int64_t>(budget_ns / 4, 1000000));
+            while (running.load()) {
+                std::this_thread::sleep_for(interval);
+                int64_t started = frame_start_ns.load();
+                unsigned long id = frame_id.load();
+                if (started == 0 || id == sampled) continue;
+                if (to_ns(Clock::now()) - started <= budget_ns) continue;
+
+                int expected = IDLE;
+                if (sample_state.compare_exchange_strong(expected, REQUESTED)) {
+                    sampled = id;
+                    pthread_kill(game_thread, SIGUSR2);
+                }
+            }
+        }
+
+    public:
+        TickWatchdog(): budget_ns(0), phase_ns{}, logged(0), frames(0), overruns(0),
+                        frame_start_ns(0), frame_id(0), sample_state(IDLE), sample_depth(0), running(false) {}
+
+        TickWatchdog(const TickWatchdog&) = delete;
+        TickWatchdog& operator=(const TickWatchdog&) = delete;
+
+        ~TickWatchdog() { stop(); }
+
+        // Call from the game thread
+        void start(int budget_ms) {
+            budget_ns = (int64_t)budget_ms * 1000000;
+            game_thread = pthread_self();
+            active() = this;
+
+            // backtrace() allocates the first time; don't let that happen in the handler
+            void* warm[2];
+            backtrace(warm, 2);
+
+            struct sigaction action;
+            memset(&action, 0, sizeof(action));
+            action.sa_handler = on_sample_signal;
+            action.sa_flags = SA_RESTART;
+            sigemptyset(&action.sa_mask);
+            sigaction(SIGUSR2, &action, nullptr);
+
+            frame_begin();
+            running = true;
+            watcher = std::thread(&TickWatchdog::watch, this);
+        }
+
+        void stop() {
+            if (!running.exchange(false)) return;
+            watcher.join();
+            frame_start_ns = 0;
+            signal(SIGUSR2, SIG_DFL);
+            active() = nullptr;
+        }
+
+        void add_phase(Phase phase, Clock::duration spent) {
+            phase_ns[phase] += std::chrono::duration_cast<std::chrono::nanoseconds>(spent).count();
+        }
+
+        void frame_begin() {
+            frame_start = Clock::now();
+            for (auto& ns : phase_ns) ns = 0;
+            frame_id.fetch_add(1);
+            frame_start_ns.store(to_ns(frame_start));
+        }
+
+        // Closes the frame and starts the next one
+        void frame_end(const State& state) {
+            auto now = Clock::now();
+            frame_start_ns.store(0);
+            int sampled = sample_state.exchange(IDLE);
+            int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - frame_start).count();
+            frames++;
+
+            if (elapsed > budget_ns) {
+                overruns++;
+                if (logged < LOG_SIZE) {
+                    SlowTick& entry = log[logged++];
+                    entry.state = state;
+                    entry.elapsed_ns = elapsed;
+                    for (int i = 0; i < PHASES; ++i) entry.phase_ns[i] = phase_ns[i];
+                    entry.depth = sampled == TAKEN ? sample_depth : 0;
+                    for (int i = 0; i < entry.depth; ++i) entry.stack[i] = sample_stack[i];
+                }
+            }
+            frame_begin();
+        }
+
+        void dump(FILE* out) const {
+            static const char* const PHASE_NAMES[PHASES] = {"input", "wait", "tick", "render", "publish"};
+            fprintf(out, "watchdog: %lu of %lu frames over the %.1f ms budget", overruns, frames, budget_ns / 1e6);
+            if (overruns > logged) fprintf(out, " (first %lu logged)", logged);
+            fprintf(out, "\n");
+            for (unsigned long i = 0; i < logged; ++i) {
+                const SlowTick& entry = log[i];
+                fprintf(out, "\nslow tick %lu: %.2f ms |", entry.state.tick, entry.elapsed_ns / 1e6);
+                for (int p = 0; p < PHASES; ++p) fprintf(out, " %s %.2f", PHASE_NAMES[p], entry.phase_ns[p] / 1e6);
+                fprintf(out, " | head (%d,%d) length %zu direction %d\n",
+                        entry.state.head_y, entry.state.head_x, entry.state.length, entry.state.direction);
+                if (entry.depth > 0) {
+                    fprintf(out, "stack sample:\n");
+                    fflush(out);
+                    backtrace_symbols_fd(entry.stack, entry.depth, fileno(out));
+                }
+            }
+        }
+};
+
+// Adds the time spent in the enclosing scope to one phase; free when null
+class WatchdogPhase {
+    private:
+        TickWatchdog* watchdog;
+        TickWatchdog::Phase phase;
+        std::chrono::steady_clock::time_point started;
+    public:
+        WatchdogPhase(TickWatchdog* set_watchdog, TickWatchdog::Phase set_phase):
+            watchdog(set_watchdog), phase(set_phase) {
+            if (watchdog) started = std::chrono::steady_clock::now();
+        }
+        ~WatchdogPhase() {
+            if (watchdog) watchdog->add_phase(phase, std::chrono::steady_clock::now() - started);
+        }
+        WatchdogPhase(const WatchdogPhase&) = delete;
+        WatchdogPhase& operator=(const WatchdogPhase&) = delete;
+};
+
+#endif // _WIN32
+
+#endif // SNAKE_WATCHDOG_H